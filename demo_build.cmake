@@ -99,6 +99,8 @@ add_executable(MiniSyncDemo
         ${CMAKE_CURRENT_BINARY_DIR}/include/minisync_api.h
         src/demo/main.cpp
         src/demo/node.cpp src/demo/node.h
+        src/replay/trace.h
+        src/demo/load.cpp src/demo/load.h
         src/demo/exception.cpp src/demo/exception.h
         src/demo/stats.cpp src/demo/stats.h
         ${PROTO_SRC}
@@ -121,3 +123,32 @@ target_link_libraries(MiniSyncDemo
         libprotobuf # link against protobuf
         CLI11 # link against CLI11
         dl ${CMAKE_THREAD_LIBS_INIT})
+
+# tests of the demo itself, e.g. that the message path doesn't allocate
+if (LIBMINISYNCPP_BUILD_TESTS)
+    add_executable(minisyncdemo_tests
+            ${CMAKE_CURRENT_BINARY_DIR}/include/demo_config.h
+            ${CMAKE_CURRENT_BINARY_DIR}/include/minisync_api.h
+            src/tests/demo_tests.cpp
+            src/tests/tests_main.cpp
+            src/bench/alloc_stats.cpp src/bench/alloc_stats.h
+            src/demo/node.cpp src/demo/node.h
+            src/replay/trace.h
+            src/demo/exception.cpp src/demo/exception.h
+            src/demo/stats.cpp src/demo/stats.h
+            ${PROTO_SRC}
+            ${LOGURU_SRC})
+
+    add_dependencies(minisyncdemo_tests libprotobuf libminisyncpp_static Catch2::Catch2)
+    target_link_libraries(minisyncdemo_tests
+            libminisyncpp_static
+            libprotobuf
+            dl ${CMAKE_THREAD_LIBS_INIT} Catch2::Catch2)
+
+    set_target_properties(minisyncdemo_tests
+            PROPERTIES
+            LINK_SEARCH_START_STATIC 1
+            LINK_SEARCH_END_STATIC 1
+            RUNTIME_OUTPUT_DIRECTORY "${CMAKE_CURRENT_BINARY_DIR}/tests"
+            OUTPUT_NAME minisyncdemo)
+endif ()
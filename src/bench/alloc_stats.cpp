@@ -0,0 +1,113 @@
+/*
+* Author: Manuel Olguín Muñoz <manuel@olguin.se>
+*
+* Copyright© 2019 Manuel Olguín Muñoz
+* See LICENSE file included in the root directory of this project for licensing and copyright details.
+*/
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include "alloc_stats.h"
+
+/*
+ * Replacements for the global allocation functions which keep track of the number and size of allocations, separately
+ * for each thread. Each block is prefixed with its size, so that frees can be accounted for too.
+ */
+
+namespace
+{
+    // keeps the alignment guaranteed by malloc
+    const size_t HEADER = alignof(std::max_align_t);
+
+    // no constructor, so it is usable from the very first allocation of every thread
+    thread_local MiniSync::Bench::AllocStats stats{0, 0, 0, 0};
+
+    void* allocate(size_t size)
+    {
+        auto* block = static_cast<unsigned char*>(std::malloc(size + HEADER));
+        if (block == nullptr) throw std::bad_alloc();
+        *reinterpret_cast<size_t*>(block) = size;
+
+        ++stats.allocations;
+        stats.bytes += size;
+        stats.live += static_cast<int64_t>(size);
+        if (stats.live > stats.peak) stats.peak = stats.live;
+        return block + HEADER;
+    }
+
+    void deallocate(void* p) noexcept
+    {
+        if (p == nullptr) return;
+        unsigned char* block = static_cast<unsigned char*>(p) - HEADER;
+        stats.live -= static_cast<int64_t>(*reinterpret_cast<size_t*>(block));
+        std::free(block);
+    }
+}
+
+MiniSync::Bench::AllocStats MiniSync::Bench::allocStats()
+{
+    return stats;
+}
+
+void MiniSync::Bench::resetAllocStats()
+{
+    stats = AllocStats{0, 0, 0, 0};
+}
+
+void* operator new(size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new[](size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return allocate(size);
+    }
+    catch (std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept
+{
+    deallocate(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    deallocate(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    deallocate(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    deallocate(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    deallocate(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    deallocate(p);
+}
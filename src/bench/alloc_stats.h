@@ -0,0 +1,36 @@
+/*
+* Author: Manuel Olguín Muñoz <manuel@olguin.se>
+*
+* Copyright© 2019 Manuel Olguín Muñoz
+* See LICENSE file included in the root directory of this project for licensing and copyright details.
+*/
+
+#ifndef MINISYNCPP_ALLOC_STATS_H
+#define MINISYNCPP_ALLOC_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace MiniSync
+{
+    namespace Bench
+    {
+        /*
+         * Heap usage through operator new by the calling thread since its last reset, tracked by the replacements in
+         * alloc_stats.cpp. Blocks freed by a different thread than the one which allocated them are only subtracted
+         * from the live bytes of the former.
+         */
+        struct AllocStats
+        {
+            uint64_t allocations; // calls to operator new
+            uint64_t bytes;       // total bytes requested
+            int64_t live;         // bytes currently allocated, relative to the reset
+            int64_t peak;         // maximum of live
+        };
+
+        AllocStats allocStats();
+        void resetAllocStats();
+    }
+}
+
+#endif //MINISYNCPP_ALLOC_STATS_H
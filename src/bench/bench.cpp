@@ -0,0 +1,419 @@
+/*
+* Author: Manuel Olguín Muñoz <manuel@olguin.se>
+*
+* Copyright© 2019 Manuel Olguín Muñoz
+* See LICENSE file included in the root directory of this project for licensing and copyright details.
+*/
+
+#include <minisync_api.h>
+#include <basic_sync.h>
+#include <fixed_tinysync.h>
+#include <fixed_minisync.h>
+#include <adjusted_clock.h>
+#include <workload.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "suite.h"
+
+/*
+ * Simple benchmarks for libminisyncpp.
+ * Feeds a long synthetic history to each algorithm and reports the mean cost per sample at several points of the
+ * history, so that growth in per-sample cost with the number of processed samples is easy to spot. Then compares
+ * adding the same history one sample at a time against adding it in batches, and the algorithms behind the virtual
+ * API against the header-only BasicSync and the fixed-size TinySync, and many peers tracked by separate algorithms
+ * behind the API against a vector of FixedTinySync. Finally, compares the cost of reading the adjusted time through
+ * the API and through AdjustedClock, measures the throughput of translating timestamps in bulk and of the synthetic
+ * workload generator, and the latency of checkpoints.
+ *
+ * With --json, runs the suite in suite.h instead and writes its results to stdout.
+ */
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    using Sample = MiniSync::API::DataPoint;
+    using MiniSync::Bench::generate;
+
+    using Factory = std::shared_ptr<MiniSync::API::Algorithm> (*)();
+
+    std::shared_ptr<MiniSync::API::Algorithm> createWindowedMiniSync()
+    {
+        MiniSync::API::Factory::MiniSyncOptions options;
+        options.window_samples = 1000;
+        return MiniSync::API::Factory::createMiniSync(options);
+    }
+
+    std::shared_ptr<MiniSync::API::Algorithm> createNanosecondTinySync()
+    {
+        MiniSync::API::Factory::TinySyncOptions options;
+        options.time = MiniSync::API::Factory::TimeRepresentation::INT64_NANOSECONDS;
+        return MiniSync::API::Factory::createTinySync(options);
+    }
+
+    std::shared_ptr<MiniSync::API::Algorithm> createNanosecondMiniSync()
+    {
+        MiniSync::API::Factory::MiniSyncOptions options;
+        options.time = MiniSync::API::Factory::TimeRepresentation::INT64_NANOSECONDS;
+        return MiniSync::API::Factory::createMiniSync(options);
+    }
+
+    void run(const std::string& name,
+             Factory factory,
+             const std::vector<Sample>& samples,
+             const std::vector<size_t>& checkpoints)
+    {
+        auto algo = factory();
+        size_t i = 0;
+        for (size_t checkpoint: checkpoints)
+        {
+            auto t_start = clock::now();
+            size_t first = i;
+            for (; i < checkpoint && i < samples.size(); ++i)
+                algo->addDataPoint(samples[i].To, samples[i].Tb, samples[i].Tr);
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t_start);
+
+            if (i == first) break;
+            printf("%-11s history %10zu | %10.1f ns/sample | drift error %.3Le\n",
+                   name.c_str(), i, static_cast<double>(elapsed.count()) / (i - first), algo->getDriftError());
+        }
+    }
+
+    /*
+     * Adds the whole history in batches of batch_size samples (single calls to addDataPoint for a batch size of 0).
+     */
+    void runBatches(const std::string& name, Factory factory, const std::vector<Sample>& samples, size_t batch_size)
+    {
+        auto algo = factory();
+        auto t_start = clock::now();
+        if (batch_size == 0)
+        {
+            for (const auto& s: samples)
+                algo->addDataPoint(s.To, s.Tb, s.Tr);
+        }
+        else
+        {
+            for (size_t i = 0; i < samples.size(); i += batch_size)
+                algo->addDataPoints(samples.data() + i, std::min(batch_size, samples.size() - i));
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t_start);
+
+        printf("%-11s batch %12zu | %10.1f ns/sample | drift error %.3Le\n",
+               name.c_str(), batch_size, static_cast<double>(elapsed.count()) / samples.size(), algo->getDriftError());
+    }
+
+    /*
+     * Adds the whole history to a BasicSync, with timestamps converted to its representation beforehand.
+     */
+    template<typename RetentionPolicy, typename TimeT>
+    void runInline(const std::string& name, const std::vector<Sample>& samples)
+    {
+        using Sync = MiniSync::BasicSync<RetentionPolicy, TimeT>;
+        std::vector<typename Sync::Sample> converted;
+        converted.reserve(samples.size());
+        for (const auto& s: samples)
+            converted.push_back({TimeT::fromMicroseconds(s.To),
+                                 TimeT::fromMicroseconds(s.Tb),
+                                 TimeT::fromMicroseconds(s.Tr)});
+
+        Sync sync;
+        auto t_start = clock::now();
+        for (const auto& s: converted)
+            sync.addDataPoint(s.To, s.Tb, s.Tr);
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t_start);
+
+        printf("%-11s inline %11s | %10.1f ns/sample | drift error %.3Le\n",
+               name.c_str(), "", static_cast<double>(elapsed.count()) / samples.size(),
+               static_cast<long double>(sync.getDriftError()));
+    }
+
+    /*
+     * Same as runInline(), for the fixed-size TinySync.
+     */
+    template<typename TimeT>
+    void runFixed(const std::string& name, const std::vector<Sample>& samples)
+    {
+        using Sync = MiniSync::BasicSync<MiniSync::Retention::TinySync, TimeT>;
+        std::vector<typename Sync::Sample> converted;
+        converted.reserve(samples.size());
+        for (const auto& s: samples)
+            converted.push_back({TimeT::fromMicroseconds(s.To),
+                                 TimeT::fromMicroseconds(s.Tb),
+                                 TimeT::fromMicroseconds(s.Tr)});
+
+        MiniSync::FixedTinySync<TimeT> sync{};
+        auto t_start = clock::now();
+        for (const auto& s: converted)
+            sync.addDataPoint(s.To, s.Tb, s.Tr);
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t_start);
+
+        printf("%-11s fixed %12s | %10.1f ns/sample | drift error %.3Le\n",
+               name.c_str(), "", static_cast<double>(elapsed.count()) / samples.size(),
+               static_cast<long double>(sync.getDriftError()));
+    }
+
+    /*
+     * Adds the whole history to a statically allocated fixed-capacity MiniSync, through its Algorithm interface.
+     */
+    template<size_t MaxPoints>
+    void runFixedMiniSync(const std::vector<Sample>& samples)
+    {
+        static MiniSync::FixedMiniSync<MaxPoints> sync;
+        auto t_start = clock::now();
+        for (const auto& s: samples)
+            sync.addDataPoint(s.To, s.Tb, s.Tr);
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t_start);
+
+        printf("%-11s fixed %12zu | %10.1f ns/sample | drift error %.3Le\n",
+               "MiniSync", MaxPoints, static_cast<double>(elapsed.count()) / samples.size(), sync.getDriftError());
+    }
+
+    /*
+     * Tracks a number of peers, each with its own synthetic workload, for about n samples in total, with one separate
+     * algorithm per peer behind the API and one FixedTinySync per peer in a vector. Reports the cost per sample and the
+     * mean drift error over the peers, which is the same for both.
+     */
+    void runPeers(size_t peers, size_t n)
+    {
+        using TimeT = MiniSync::Time::Int64Nanoseconds;
+        using Fixed = MiniSync::FixedTinySync<TimeT>;
+        const size_t rounds = std::max<size_t>(n / peers, 2);
+        struct Update
+        {
+            uint32_t peer;
+            Fixed::point_t To, Tb, Tr;
+        };
+
+        // round r holds one sample of each peer, in order
+        std::vector<Sample> samples(rounds * peers);
+        std::vector<Update> updates(samples.size());
+        for (size_t p = 0; p < peers; ++p)
+        {
+            MiniSync::Workload::Options options;
+            options.skew = (static_cast<double>(p % 200) - 100) * 1e-6;
+            MiniSync::Workload::Generator generator{p, options};
+            for (size_t r = 0; r < rounds; ++r)
+            {
+                const Sample s = generator.next().point;
+                samples[r * peers + p] = s;
+                updates[r * peers + p] = {static_cast<uint32_t>(p), TimeT::fromMicroseconds(s.To),
+                                          TimeT::fromMicroseconds(s.Tb), TimeT::fromMicroseconds(s.Tr)};
+            }
+        }
+        auto report = [&](const char* name, std::chrono::nanoseconds elapsed, long double error_sum)
+        {
+            char label[32];
+            snprintf(label, sizeof(label), "%zu peers", peers);
+            printf("%-11s %18s | %10.1f ns/sample | drift error %.3Le\n",
+                   name, label, static_cast<double>(elapsed.count()) / samples.size(), error_sum / peers);
+        };
+
+        std::vector<std::shared_ptr<MiniSync::API::Algorithm>> algos;
+        for (size_t p = 0; p < peers; ++p) algos.push_back(createNanosecondTinySync());
+        auto t_start = clock::now();
+        for (size_t i = 0; i < samples.size(); ++i)
+            algos[i % peers]->addDataPoint(samples[i].To, samples[i].Tb, samples[i].Tr);
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t_start);
+        long double error_sum = 0;
+        for (const auto& algo: algos) error_sum += algo->getDriftError();
+        report("API", elapsed, error_sum);
+
+        std::vector<Fixed> fixed(peers, Fixed{});
+        t_start = clock::now();
+        for (const auto& u: updates)
+            fixed[u.peer].addDataPoint(u.To, u.Tb, u.Tr);
+        elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t_start);
+        error_sum = 0;
+        for (const auto& f: fixed) error_sum += f.getDriftError();
+        report("Fixed", elapsed, error_sum);
+    }
+
+    /*
+     * Reads the adjusted time n times through getCurrentAdjustedTime() and through an AdjustedClock with the same
+     * estimates and clock base (system_clock since the epoch), so both compute the same reference time.
+     */
+    void runClock(const std::vector<Sample>& samples, size_t n)
+    {
+        auto algo = MiniSync::API::Factory::createTinySync();
+        algo->addDataPoints(samples.data(), samples.size());
+        MiniSync::AdjustedClock<std::chrono::system_clock> adjusted{};
+        adjusted.update(algo->getEstimates());
+
+        long double sink = 0; // keep the reads from being optimized away
+        auto t_start = clock::now();
+        for (size_t i = 0; i < n; ++i)
+            sink += algo->getCurrentAdjustedTime().time_since_epoch().count();
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t_start);
+        printf("%-11s %18s | %10.1f ns/read   | (%Lg)\n",
+               "API", "adjusted time", static_cast<double>(elapsed.count()) / n, sink);
+
+        // unsigned, as the sum of epoch readings in ns overflows
+        uint64_t isink = 0;
+        t_start = clock::now();
+        for (size_t i = 0; i < n; ++i)
+            isink += static_cast<uint64_t>(adjusted.now().count());
+        elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t_start);
+        printf("%-11s %18s | %10.1f ns/read   | (%llu)\n",
+               "Adjusted", "adjusted time", static_cast<double>(elapsed.count()) / n,
+               static_cast<unsigned long long>(isink));
+
+        // the clock read alone, for reference
+        isink = 0;
+        t_start = clock::now();
+        for (size_t i = 0; i < n; ++i)
+            isink += static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+        elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t_start);
+        printf("%-11s %18s | %10.1f ns/read   | (%llu)\n",
+               "system", "clock read", static_cast<double>(elapsed.count()) / n,
+               static_cast<unsigned long long>(isink));
+    }
+
+    /*
+     * Translates n local timestamps to the reference time base with bounds, through toReferenceTime() and through a
+     * plain long double loop over the estimates (without bounds).
+     */
+    void runTranslate(const std::vector<Sample>& samples, size_t n)
+    {
+        auto algo = MiniSync::API::Factory::createMiniSync();
+        algo->addDataPoints(samples.data(), samples.size());
+
+        std::vector<int64_t> local(n);
+        std::vector<int64_t> reference(n);
+        std::vector<int64_t> lower(n);
+        std::vector<int64_t> upper(n);
+        const int64_t last = std::llround(samples.back().Tr.count() * 1000);
+        for (size_t i = 0; i < n; ++i)
+            local[i] = last + static_cast<int64_t>(i) * 1000;
+
+        const int rounds = 10;
+        auto t_start = clock::now();
+        for (int r = 0; r < rounds; ++r)
+            algo->toReferenceTime(local.data(), n, reference.data(), lower.data(), upper.data());
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t_start);
+        printf("%-11s %18s | %10.1f M/s        | bounds %lld\n",
+               "MiniSync", "toReferenceTime", 1e3 * rounds * n / elapsed.count(),
+               static_cast<long long>(upper[n - 1] - lower[n - 1]));
+
+        const long double drift = algo->getDrift();
+        const long double offset = algo->getOffset().count() * 1000;
+        t_start = clock::now();
+        for (int r = 0; r < rounds; ++r)
+            for (size_t i = 0; i < n; ++i)
+                reference[i] = std::llround((local[i] - offset) / drift);
+        elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t_start);
+        printf("%-11s %18s | %10.1f M/s        | (%lld)\n",
+               "long double", "estimate only", 1e3 * rounds * n / elapsed.count(),
+               static_cast<long long>(reference[n - 1]));
+    }
+
+    /*
+     * Generates n samples of a synthetic workload with heavy-tailed delays and loss, and reports the throughput.
+     */
+    void runGenerator(size_t n)
+    {
+        MiniSync::Workload::Options options;
+        options.skew_wander = 1e-9;
+        options.backward.tail_probability = 0.01;
+        options.loss_probability = 0.01;
+
+        std::vector<Sample> samples(n);
+        MiniSync::Workload::Generator generator{42, options};
+        auto t_start = clock::now();
+        generator.fill(samples.data(), n);
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t_start);
+        printf("%-11s %18s | %10.1f M/s        | lost %llu\n",
+               "Workload", "generated samples", 1e3 * n / elapsed.count(),
+               static_cast<unsigned long long>(generator.lost()));
+    }
+
+    /*
+     * Takes a checkpoint after the whole history and restores it into a new instance, reporting the mean latency of
+     * both over a number of rounds.
+     */
+    void runRestore(const std::string& name, Factory factory, const std::vector<Sample>& samples)
+    {
+        auto algo = factory();
+        algo->addDataPoints(samples.data(), samples.size());
+
+        const int rounds = 100;
+        std::vector<uint8_t> blob;
+        auto t_start = clock::now();
+        for (int r = 0; r < rounds; ++r)
+            blob = algo->checkpoint();
+        auto t_save = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t_start);
+
+        auto restored = factory();
+        t_start = clock::now();
+        for (int r = 0; r < rounds; ++r)
+            restored->restore(blob.data(), blob.size());
+        auto t_restore = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t_start);
+
+        printf("%-11s checkpoint %7zu B | %10.1f µs save | %10.1f µs restore | drift error %.3Le\n",
+               name.c_str(), blob.size(), t_save.count() / 1e3 / rounds, t_restore.count() / 1e3 / rounds,
+               restored->getDriftError());
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    bool json = argc > 1 && std::string(argv[1]) == "--json";
+    if (json)
+    {
+        --argc;
+        ++argv;
+    }
+
+    size_t total = json ? 10000000 : 100000;
+    if (argc > 1) total = std::stoul(argv[1]);
+    if (json)
+    {
+        MiniSync::Bench::runSuite(total, stdout);
+        return 0;
+    }
+
+    std::vector<size_t> checkpoints;
+    for (size_t c = 100; c <= total; c *= 10) checkpoints.push_back(c);
+
+    auto samples = generate(total, 200.0, 42);
+    run("TinySync", MiniSync::API::Factory::createTinySync, samples, checkpoints);
+    run("MiniSync", MiniSync::API::Factory::createMiniSync, samples, checkpoints);
+    run("MiniSync/W", createWindowedMiniSync, samples, checkpoints);
+    run("TinySync/ns", createNanosecondTinySync, samples, checkpoints);
+    run("MiniSync/ns", createNanosecondMiniSync, samples, checkpoints);
+
+    for (size_t batch_size: {0, 16, 256, 4096})
+    {
+        runBatches("TinySync", MiniSync::API::Factory::createTinySync, samples, batch_size);
+        runBatches("MiniSync", MiniSync::API::Factory::createMiniSync, samples, batch_size);
+        runBatches("MiniSync/W", createWindowedMiniSync, samples, batch_size);
+    }
+
+    // same as batch size 0 above, without going through the virtual API
+    runInline<MiniSync::Retention::TinySync, MiniSync::Time::LongDoubleMicroseconds>("TinySync", samples);
+    runFixed<MiniSync::Time::LongDoubleMicroseconds>("TinySync", samples);
+    runInline<MiniSync::Retention::MiniSync, MiniSync::Time::LongDoubleMicroseconds>("MiniSync", samples);
+    runFixedMiniSync<4>(samples);
+    runFixedMiniSync<64>(samples);
+    runBatches("TinySync/ns", createNanosecondTinySync, samples, 0);
+    runInline<MiniSync::Retention::TinySync, MiniSync::Time::Int64Nanoseconds>("TinySync/ns", samples);
+    runFixed<MiniSync::Time::Int64Nanoseconds>("TinySync/ns", samples);
+    runBatches("MiniSync/ns", createNanosecondMiniSync, samples, 0);
+    runInline<MiniSync::Retention::MiniSync, MiniSync::Time::Int64Nanoseconds>("MiniSync/ns", samples);
+
+    runPeers(4096, 10 * total);
+
+    runClock(samples, 10 * total);
+    runTranslate(samples, 10 * total);
+
+    runGenerator(10 * total);
+
+    runRestore("TinySync", MiniSync::API::Factory::createTinySync, samples);
+    runRestore("MiniSync", MiniSync::API::Factory::createMiniSync, samples);
+    runRestore("MiniSync/W", createWindowedMiniSync, samples);
+    runRestore("MiniSync/ns", createNanosecondMiniSync, samples);
+    return 0;
+}
@@ -0,0 +1,185 @@
+/*
+* Author: Manuel Olguín Muñoz <manuel@olguin.se>
+*
+* Copyright© 2019 Manuel Olguín Muñoz
+* See LICENSE file included in the root directory of this project for licensing and copyright details.
+*/
+
+#include <lib_config.h>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <sys/resource.h>
+#include <workload.h>
+#include "alloc_stats.h"
+#include "suite.h"
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+    using Factory = std::shared_ptr<MiniSync::API::Algorithm> (*)();
+
+    std::shared_ptr<MiniSync::API::Algorithm> createWindowedMiniSync()
+    {
+        MiniSync::API::Factory::MiniSyncOptions options;
+        options.window_samples = 1000;
+        return MiniSync::API::Factory::createMiniSync(options);
+    }
+
+    struct Algorithm
+    {
+        const char* name;
+        Factory factory;
+    };
+
+    int64_t nanoseconds(clock::duration d)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+    }
+
+    /*
+     * Cost of the two clock reads around each timed call, i.e. the minimum latency that can be measured.
+     */
+    int64_t timerOverhead()
+    {
+        int64_t best = std::numeric_limits<int64_t>::max();
+        for (int i = 0; i < 10000; ++i)
+        {
+            auto t0 = clock::now();
+            auto t1 = clock::now();
+            best = std::min(best, nanoseconds(t1 - t0));
+        }
+        return best;
+    }
+
+    // value at quantile q of the sorted latencies
+    uint32_t percentile(const std::vector<uint32_t>& sorted, double q)
+    {
+        return sorted[std::min(sorted.size() - 1, static_cast<size_t>(q * sorted.size()))];
+    }
+
+    /*
+     * Mean cost in ns of calling f, over enough calls to dwarf the clock reads.
+     */
+    template<typename F>
+    double timeCalls(F f)
+    {
+        const int calls = 100000;
+        auto t_start = clock::now();
+        for (int i = 0; i < calls; ++i) f();
+        return static_cast<double>(nanoseconds(clock::now() - t_start)) / calls;
+    }
+
+    /*
+     * Feeds n samples of the workload to the algorithm, timing each call. The samples are generated in chunks between
+     * the timed calls, so that the largest workloads don't have to be held in memory.
+     */
+    void runWorkload(const Algorithm& algorithm, size_t n, double jitter, bool first, FILE* out)
+    {
+        const size_t chunk = 4096;
+        std::vector<uint32_t> latencies(n);
+        std::vector<MiniSync::API::DataPoint> samples(chunk);
+        MiniSync::Workload::Generator generator{42, MiniSync::Bench::workloadOptions(jitter)};
+
+        // only allocations made by the algorithm itself are counted from here on
+        MiniSync::Bench::resetAllocStats();
+        auto algo = algorithm.factory();
+        for (size_t start = 0; start < n; start += chunk)
+        {
+            const size_t count = std::min(chunk, n - start);
+            generator.fill(samples.data(), count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                auto t0 = clock::now();
+                algo->addDataPoint(samples[i].To, samples[i].Tb, samples[i].Tr);
+                auto t1 = clock::now();
+                latencies[start + i] = static_cast<uint32_t>(std::min<int64_t>(nanoseconds(t1 - t0), UINT32_MAX));
+            }
+        }
+        const MiniSync::Bench::AllocStats allocs = MiniSync::Bench::allocStats();
+
+        // the estimates are read through volatile to keep the calls from being optimized away
+        volatile long double sink;
+        const double getter_ns = timeCalls([&]()
+                                           {
+                                               sink = algo->getDrift();
+                                               sink = algo->getDriftError();
+                                               sink = algo->getOffset().count();
+                                               sink = algo->getOffsetError().count();
+                                           }) / 4;
+        const double estimates_ns = timeCalls([&]()
+                                              { sink = algo->getEstimates().drift; });
+        const double adjusted_ns = timeCalls([&]()
+                                             { sink = algo->getCurrentAdjustedTime().time_since_epoch().count(); });
+        (void) sink;
+        const size_t state_bytes = algo->checkpoint().size();
+        const MiniSync::API::Metrics metrics = algo->getMetrics();
+
+        double mean = 0;
+        for (uint32_t l: latencies) mean += l;
+        mean /= n;
+        std::sort(latencies.begin(), latencies.end());
+
+        fprintf(out, "%s    {\"algorithm\": \"%s\", \"jitter_us\": %g, \"samples\": %zu,\n",
+                first ? "" : ",\n", algorithm.name, jitter, n);
+        fprintf(out, "     \"latency_ns\": {\"mean\": %.1f, \"p50\": %u, \"p90\": %u, \"p99\": %u, \"p999\": %u, "
+                     "\"max\": %u},\n",
+                mean, percentile(latencies, 0.5), percentile(latencies, 0.9), percentile(latencies, 0.99),
+                percentile(latencies, 0.999), latencies.back());
+        fprintf(out, "     \"allocations_per_sample\": %.4f, \"bytes_allocated_per_sample\": %.2f, "
+                     "\"peak_heap_bytes\": %lld, \"state_bytes\": %zu,\n",
+                static_cast<double>(allocs.allocations) / n, static_cast<double>(allocs.bytes) / n,
+                static_cast<long long>(allocs.peak), state_bytes);
+        fprintf(out, "     \"stored_points\": %zu, \"memory_bytes\": %zu, \"pairs_evaluated_per_sample\": %.2f,\n",
+                metrics.low_points + metrics.high_points, metrics.memory_bytes,
+                static_cast<double>(metrics.pairs_evaluated) / n);
+        fprintf(out, "     \"getter_ns\": %.2f, \"get_estimates_ns\": %.2f, \"get_current_adjusted_time_ns\": %.2f,\n",
+                getter_ns, estimates_ns, adjusted_ns);
+        fprintf(out, "     \"drift_error\": %.6Le, \"offset_error_us\": %.6Le}",
+                algo->getDriftError(), algo->getOffsetError().count());
+        fflush(out);
+    }
+}
+
+MiniSync::Workload::Options MiniSync::Bench::workloadOptions(double jitter)
+{
+    Workload::Options options;
+    options.forward.mean_jitter = jitter;
+    options.backward.mean_jitter = jitter;
+    return options;
+}
+
+std::vector<MiniSync::API::DataPoint> MiniSync::Bench::generate(size_t n, double jitter, uint32_t seed)
+{
+    std::vector<API::DataPoint> samples(n);
+    Workload::Generator{seed, workloadOptions(jitter)}.fill(samples.data(), n);
+    return samples;
+}
+
+void MiniSync::Bench::runSuite(size_t max_samples, FILE* out)
+{
+    const Algorithm algorithms[] = {{"tinysync", MiniSync::API::Factory::createTinySync},
+                                    {"minisync", MiniSync::API::Factory::createMiniSync},
+                                    {"minisync_window_1000", createWindowedMiniSync}};
+
+    fprintf(out, "{\n  \"format\": 1,\n  \"library_version\": \"%s\",\n  \"timer_overhead_ns\": %lld,\n"
+                 "  \"results\": [\n", LIB_BUILD_VERSION, static_cast<long long>(timerOverhead()));
+
+    bool first = true;
+    for (double jitter: {20.0, 200.0, 2000.0})
+    {
+        for (size_t n = 100; n <= max_samples; n *= 10)
+        {
+            for (const auto& algorithm: algorithms)
+            {
+                runWorkload(algorithm, n, jitter, first, out);
+                first = false;
+            }
+        }
+    }
+
+    struct rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    fprintf(out, "\n  ],\n  \"max_rss_kb\": %ld\n}\n", usage.ru_maxrss);
+}
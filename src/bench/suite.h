@@ -0,0 +1,42 @@
+/*
+* Author: Manuel Olguín Muñoz <manuel@olguin.se>
+*
+* Copyright© 2019 Manuel Olguín Muñoz
+* See LICENSE file included in the root directory of this project for licensing and copyright details.
+*/
+
+#ifndef MINISYNCPP_SUITE_H
+#define MINISYNCPP_SUITE_H
+
+#include <minisync_api.h>
+#include <workload.h>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace MiniSync
+{
+    namespace Bench
+    {
+        /*
+         * The default synthetic workload (see workload.h), with exponentially distributed network delays with a mean
+         * of jitter µs.
+         */
+        Workload::Options workloadOptions(double jitter);
+
+        /*
+         * Generates n exchanges of the default synthetic workload (see workload.h), with exponentially distributed
+         * network delays with a mean of jitter µs.
+         */
+        std::vector<API::DataPoint> generate(size_t n, double jitter, uint32_t seed);
+
+        /*
+         * Runs TinySync and MiniSync (plain and windowed) over synthetic workloads of 10^2 up to max_samples samples
+         * at several jitter levels, and writes the results as JSON to out: percentiles of the per-sample latency,
+         * allocations per sample, peak heap usage, size of the retained state and cost of the getters.
+         */
+        void runSuite(size_t max_samples, FILE* out);
+    }
+}
+
+#endif //MINISYNCPP_SUITE_H
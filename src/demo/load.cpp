@@ -0,0 +1,255 @@
+/*
+* Author: Manuel Olguín Muñoz <manuel@olguin.se>
+*
+* Copyright© 2019 Manuel Olguín Muñoz
+* See LICENSE file included in the root directory of this project for licensing and copyright details.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <loguru.hpp>
+#include <demo_config.h>
+#include "load.h"
+#include "exception.h"
+
+const uint32_t MiniSync::LoadGenerator::RETRY_TIMEOUT_USEC;
+
+MiniSync::LoadGenerator::LoadGenerator(const std::string& peer,
+                                       uint16_t peer_port,
+                                       uint32_t n_clients,
+                                       double duration_sec,
+                                       uint32_t threads) :
+    peer_addr({}),
+    duration(duration_sec),
+    running(true)
+{
+    memset(&this->peer_addr, 0, sizeof(SOCKADDR));
+    this->peer_addr.sin_family = AF_INET;
+    this->peer_addr.sin_addr.s_addr = inet_addr(peer.c_str());
+    this->peer_addr.sin_port = htons(peer_port);
+
+    threads = std::max(1u, std::min(threads, n_clients));
+    for (uint32_t t = 0; t < threads; ++t)
+    {
+        std::unique_ptr<Shard> shard{new Shard{}};
+        shard->epoll_fd = epoll_create1(0);
+        CHECK_GE_F(shard->epoll_fd, 0, "Call to epoll_create1 failed. ERRNO: %s", strerror(errno));
+        // spread the clients evenly
+        shard->clients.resize(n_clients / threads + (t < n_clients % threads ? 1 : 0));
+        shard->latencies.reserve((1u << 20u) / threads);
+
+        // one non-blocking socket per client, bound to an ephemeral port
+        for (uint32_t i = 0; i < shard->clients.size(); ++i)
+        {
+            Client& client = shard->clients[i];
+            client.sock_fd = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+            CHECK_GE_F(client.sock_fd, 0, "Failed to create socket for client. ERRNO: %s", strerror(errno));
+            client.seq = 0;
+            client.ready = false;
+
+            int flags = fcntl(client.sock_fd, F_GETFL, 0);
+            CHECK_GE_F(fcntl(client.sock_fd, F_SETFL, flags | O_NONBLOCK), 0,
+                       "Failed setting socket to non-blocking mode. ERRNO: %s", strerror(errno));
+
+            struct epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.u32 = i;
+            CHECK_GE_F(epoll_ctl(shard->epoll_fd, EPOLL_CTL_ADD, client.sock_fd, &event), 0,
+                       "Call to epoll_ctl failed. ERRNO: %s", strerror(errno));
+        }
+        this->shards.push_back(std::move(shard));
+    }
+}
+
+MiniSync::LoadGenerator::~LoadGenerator()
+{
+    for (auto& shard : this->shards)
+    {
+        for (Client& client : shard->clients)
+            close(client.sock_fd);
+        close(shard->epoll_fd);
+    }
+}
+
+void MiniSync::LoadGenerator::shut_down()
+{
+    this->running.store(false);
+}
+
+void MiniSync::LoadGenerator::send(Shard& shard, Client& client, MiniSync::Protocol::MiniSyncMsg& msg)
+{
+    size_t out_sz = msg.ByteSizeLong();
+    msg.SerializeToArray(shard.buf, out_sz);
+    client.sent = std::chrono::steady_clock::now();
+    if (sendto(client.sock_fd, shard.buf, out_sz, 0, (struct sockaddr*) &this->peer_addr, sizeof(SOCKADDR)) !=
+        static_cast<ssize_t>(out_sz))
+        DLOG_F(WARNING, "Could not write to socket."); // lost, will be retried
+}
+
+void MiniSync::LoadGenerator::beacon(Shard& shard, Client& client, MiniSync::Protocol::MiniSyncMsg& msg)
+{
+    msg.mutable_beacon()->set_seq(++client.seq);
+    this->send(shard, client, msg);
+}
+
+void MiniSync::LoadGenerator::handshake(Shard& shard)
+{
+    MiniSync::Protocol::MiniSyncMsg msg{};
+    msg.mutable_handshake()->set_mode(MiniSync::Protocol::NodeMode::SYNC);
+    msg.mutable_handshake()->set_version_major(PROTOCOL_VERSION_MAJOR);
+    msg.mutable_handshake()->set_version_minor(PROTOCOL_VERSION_MINOR);
+
+    MiniSync::Protocol::MiniSyncMsg incoming{};
+    std::vector<struct epoll_event> events(shard.clients.size());
+    auto timeout = std::chrono::microseconds(MiniSync::LoadGenerator::RETRY_TIMEOUT_USEC);
+    size_t pending = shard.clients.size();
+
+    // (re)send handshakes to the clients that haven't got a reply yet, for up to 50 tries
+    for (int attempt = 0; pending > 0 && attempt < 50 && this->running.load(); ++attempt)
+    {
+        for (Client& client : shard.clients)
+            if (!client.ready) this->send(shard, client, msg);
+
+        auto retry_at = std::chrono::steady_clock::now() + timeout;
+        while (pending > 0 && std::chrono::steady_clock::now() < retry_at)
+        {
+            int ready = epoll_wait(shard.epoll_fd, events.data(), events.size(),
+                                   MiniSync::LoadGenerator::RETRY_TIMEOUT_USEC / 1000);
+            for (int i = 0; i < ready; ++i)
+            {
+                Client& client = shard.clients[events[i].data.u32];
+                ssize_t recv_sz;
+                while ((recv_sz = recvfrom(client.sock_fd, shard.buf, MAX_MSG_LEN, 0, nullptr, nullptr)) >= 0)
+                {
+                    if (client.ready || !incoming.ParseFromArray(shard.buf, recv_sz) || !incoming.has_handshake_r())
+                        continue;
+                    if (incoming.handshake_r().status() != Protocol::HandshakeReply_Status_SUCCESS)
+                    {
+                        LOG_F(ERROR, "Handshake failed with status %d.", incoming.handshake_r().status());
+                        throw MiniSync::Exceptions::SocketReadException();
+                    }
+                    client.ready = true;
+                    --pending;
+                }
+            }
+        }
+    }
+
+    if (pending > 0)
+    {
+        LOG_F(ERROR, "%" PRISIZE_T " clients timed out waiting for handshake replies.", pending);
+        throw MiniSync::Exceptions::TimeoutException();
+    }
+}
+
+/*
+ * Keeps one beacon in flight per client of the shard until t_end.
+ */
+void MiniSync::LoadGenerator::load(Shard& shard, std::chrono::steady_clock::time_point t_end)
+{
+    MiniSync::Protocol::MiniSyncMsg msg{};
+    MiniSync::Protocol::MiniSyncMsg incoming{};
+    std::vector<struct epoll_event> events(shard.clients.size());
+    auto timeout = std::chrono::microseconds(MiniSync::LoadGenerator::RETRY_TIMEOUT_USEC);
+
+    auto now = std::chrono::steady_clock::now();
+    auto next_retry_check = now + timeout / 10;
+    for (Client& client : shard.clients)
+        this->beacon(shard, client, msg);
+
+    while (now < t_end && this->running.load())
+    {
+        int ready = epoll_wait(shard.epoll_fd, events.data(), events.size(), 10);
+        for (int i = 0; i < ready; ++i)
+        {
+            Client& client = shard.clients[events[i].data.u32];
+            ssize_t recv_sz;
+            while ((recv_sz = recvfrom(client.sock_fd, shard.buf, MAX_MSG_LEN, 0, nullptr, nullptr)) >= 0)
+            {
+                auto t_in = std::chrono::steady_clock::now();
+                // ignore anything but the reply to the current beacon
+                if (!incoming.ParseFromArray(shard.buf, recv_sz) || !incoming.has_beacon_r() ||
+                    incoming.beacon_r().seq() != client.seq)
+                    continue;
+
+                shard.latencies.push_back(std::chrono::duration<double, std::micro>(t_in - client.sent).count());
+                this->beacon(shard, client, msg);
+            }
+        }
+
+        now = std::chrono::steady_clock::now();
+        if (now >= next_retry_check)
+        {
+            for (Client& client : shard.clients)
+            {
+                if (now - client.sent < timeout) continue;
+                shard.lost++;
+                this->beacon(shard, client, msg);
+            }
+            next_retry_check = now + timeout / 10;
+        }
+    }
+
+    // say goodbye, but don't wait for the replies
+    msg.mutable_goodbye();
+    for (Client& client : shard.clients)
+        this->send(shard, client, msg);
+}
+
+MiniSync::LoadGenerator::Results MiniSync::LoadGenerator::run()
+{
+    Results results{};
+    for (auto& shard : this->shards)
+    {
+        results.clients += static_cast<uint32_t>(shard->clients.size());
+        shard->latencies.clear();
+        shard->lost = 0;
+    }
+
+    LOG_F(INFO, "Handshaking %" PRIu32 " clients.", results.clients);
+    for (auto& shard : this->shards)
+        this->handshake(*shard);
+
+    LOG_F(INFO, "Sending beacons for %f seconds from %" PRISIZE_T " threads.", this->duration.count(),
+          this->shards.size());
+    auto t_start = std::chrono::steady_clock::now();
+    auto t_end = t_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(this->duration);
+
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < this->shards.size(); ++t)
+    {
+        Shard* shard = this->shards[t].get();
+        threads.emplace_back([this, shard, t_end]() { this->load(*shard, t_end); });
+    }
+    this->load(*this->shards.front(), t_end);
+    for (std::thread& thread : threads)
+        thread.join();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+
+    std::vector<double> latencies;
+    for (auto& shard : this->shards)
+    {
+        latencies.insert(latencies.end(), shard->latencies.begin(), shard->latencies.end());
+        results.lost += shard->lost;
+    }
+
+    results.replies = latencies.size();
+    results.replies_per_sec = results.replies / elapsed;
+    if (!latencies.empty())
+    {
+        auto percentile = [&latencies](double p) -> double
+        {
+            auto nth = latencies.begin() + static_cast<size_t>(p * (latencies.size() - 1));
+            std::nth_element(latencies.begin(), nth, latencies.end());
+            return *nth;
+        };
+        results.latency_p50 = percentile(0.5);
+        results.latency_p99 = percentile(0.99);
+        results.latency_max = *std::max_element(latencies.begin(), latencies.end());
+    }
+    return results;
+}
@@ -0,0 +1,89 @@
+/*
+* Author: Manuel Olguín Muñoz <manuel@olguin.se>
+*
+* Copyright© 2019 Manuel Olguín Muñoz
+* See LICENSE file included in the root directory of this project for licensing and copyright details.
+*/
+
+#ifndef MINISYNCPP_LOAD_H
+#define MINISYNCPP_LOAD_H
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <memory>
+#include <string>
+#include <vector>
+#include "node.h"
+
+namespace MiniSync
+{
+    /*
+     * Benchmarks a ReferenceNode by simulating many SyncNodes: every client gets its own UDP socket (and thus its own
+     * address), completes the handshake, and then keeps exactly one beacon in flight for the duration of the run,
+     * sending the next one as soon as the reply arrives. Reports the replies per second and the distribution of the
+     * reply latency (time from sending a beacon to receiving its reply) to stdout.
+     *
+     * Beacons that go unanswered for RETRY_TIMEOUT_USEC are counted as lost and sent again with a new sequence number.
+     *
+     * The clients can be split among several threads, to load references with more than one worker.
+     */
+    class LoadGenerator
+    {
+    public:
+        static const uint32_t RETRY_TIMEOUT_USEC = 100000; // 100 ms, as for SyncNodes
+
+        struct Results
+        {
+            uint32_t clients;
+            uint64_t replies;
+            uint64_t lost;
+            double replies_per_sec;
+            // reply latency, in µs
+            double latency_p50;
+            double latency_p99;
+            double latency_max;
+        };
+
+        LoadGenerator(const std::string& peer,
+                      uint16_t peer_port,
+                      uint32_t n_clients,
+                      double duration_sec,
+                      uint32_t threads = 1);
+        ~LoadGenerator();
+
+        Results run();
+        void shut_down();
+
+    private:
+        struct Client
+        {
+            int sock_fd;
+            uint32_t seq;
+            bool ready; // completed handshake
+            std::chrono::steady_clock::time_point sent;
+        };
+
+        // the clients of one thread
+        struct Shard
+        {
+            int epoll_fd;
+            std::vector<Client> clients;
+            std::vector<double> latencies;
+            uint64_t lost;
+            uint8_t buf[MAX_MSG_LEN];
+        };
+
+        SOCKADDR peer_addr;
+        const std::chrono::duration<double> duration;
+        std::vector<std::unique_ptr<Shard>> shards;
+        std::atomic_bool running;
+
+        void send(Shard& shard, Client& client, MiniSync::Protocol::MiniSyncMsg& msg);
+        void beacon(Shard& shard, Client& client, MiniSync::Protocol::MiniSyncMsg& msg);
+        void handshake(Shard& shard);
+        void load(Shard& shard, std::chrono::steady_clock::time_point t_end);
+    };
+}
+
+#endif //MINISYNCPP_LOAD_H
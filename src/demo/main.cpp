@@ -11,14 +11,18 @@
 #include <loguru.hpp>
 #include <CLI/CLI.hpp>
 #include "node.h"
+#include "load.h"
 #include "exception.h"
 
 MiniSync::Node* node = nullptr;
+MiniSync::LoadGenerator* load = nullptr;
 
 void sig_handler(int)
 {
     if (node != nullptr)
         node->shut_down();
+    else if (load != nullptr)
+        load->shut_down();
     else exit(0);
 }
 
@@ -33,8 +37,15 @@ int main(int argc, char* argv[])
     uint16_t port;
     uint16_t bind_port;
     std::string output_file;
+    std::string trace_file;
     double bandwidth = -1.0;
     double min_ping = -1.0;
+    uint32_t clients = 1;
+    uint32_t batch_size = MiniSync::ReferenceNode::DEFAULT_BATCH_SIZE;
+    uint32_t workers = 1;
+    uint32_t threads = 1;
+    double duration = 10.0;
+    MiniSync::TimestampOptions timestamps{};
 
     std::ostringstream app_description{};
     app_description
@@ -47,6 +58,14 @@ int main(int argc, char* argv[])
                                                     "i.e. other peers synchronize to this node's clock.");
     ref_mode->add_option<uint16_t>("BIND_PORT", bind_port, "Local UDP port to bind to.")->required(true);
     ref_mode->add_option("-v", loguru::g_stderr_verbosity, "Set verbosity level.", true);
+    ref_mode->add_option("-b,--batch", batch_size,
+                         "Maximum number of messages read and answered at once (1 handles them one by one).", true);
+    ref_mode->add_option("-w,--workers", workers,
+                         "Number of worker threads, each pinned to a core and with its own socket on BIND_PORT.", true);
+    ref_mode->add_flag("-k,--kernel-timestamps", timestamps.kernel,
+                       "Timestamp messages in the kernel instead of in the application.");
+    ref_mode->add_option("--hw-timestamps", timestamps.hw_interface,
+                         "Timestamp messages on the NIC of this network interface, if supported (implies -k).", false);
 
     auto* sync_mode = app.add_subcommand("SYNC_MODE", "Start node in synchronization mode.");
 
@@ -55,12 +74,26 @@ int main(int argc, char* argv[])
     sync_mode->add_option<uint16_t>("PORT", port, "Target UDP Port on peer.")->required(true);
     sync_mode->add_option("-v", loguru::g_stderr_verbosity, "Set verbosity level.", true);
     sync_mode->add_option("-o,--output", output_file, "Output stats to file.", false);
+    sync_mode->add_option("--trace", trace_file,
+                          "Record the timestamps of every exchange to a binary trace for minisync_replay.", false);
     sync_mode->add_option("-b,--bandwidth", bandwidth, // sync node is the only one that adjusts based on bandwidth
                           "Nominal bandwidth in Mbps, for minimum delay estimation.",
                           false);
     sync_mode->add_option("-p,--ping", min_ping,
                           "Nominal minimum ICMP ping RTT in milliseconds for better minimum delay estimation.",
                           false);
+    sync_mode->add_flag("-k,--kernel-timestamps", timestamps.kernel,
+                        "Timestamp messages in the kernel instead of in the application.");
+    sync_mode->add_option("--hw-timestamps", timestamps.hw_interface,
+                          "Timestamp messages on the NIC of this network interface, if supported (implies -k).", false);
+
+    auto* bench_mode = app.add_subcommand("BENCH_MODE", "Benchmark a reference node by simulating many sync nodes.");
+    bench_mode->add_option<std::string>("ADDRESS", peer, "Address of the reference node.")->required(true);
+    bench_mode->add_option<uint16_t>("PORT", port, "Target UDP Port on the reference node.")->required(true);
+    bench_mode->add_option("-v", loguru::g_stderr_verbosity, "Set verbosity level.", true);
+    bench_mode->add_option("-c,--clients", clients, "Number of simulated sync nodes.", true);
+    bench_mode->add_option("-d,--duration", duration, "Duration of the benchmark in seconds.", true);
+    bench_mode->add_option("-t,--threads", threads, "Number of threads to split the simulated nodes among.", true);
 
     app.fallthrough(true);
     app.require_subcommand(1, 1);
@@ -69,12 +102,13 @@ int main(int argc, char* argv[])
 
     auto modes = app.get_subcommands();
     CHECK_EQ_F(modes.size(), 1, "Wrong number of subcommands - THIS SHOULD NEVER HAPPEN?");
+    timestamps.kernel = timestamps.kernel || !timestamps.hw_interface.empty();
 
     if (modes.front()->get_name() == "REF_MODE")
     {
         // LOG_F(INFO, "Started node in REFERENCE mode.");
         // MiniSync::ReferenceNode node{bind_port};
-        node = new MiniSync::ReferenceNode{bind_port};
+        node = new MiniSync::ReferenceNode{bind_port, batch_size, workers, timestamps};
     }
     else if (modes.front()->get_name() == "SYNC_MODE")
     {
@@ -82,7 +116,31 @@ int main(int argc, char* argv[])
 
         node = new MiniSync::SyncNode(bind_port, peer, port,
                                       MiniSync::API::Factory::createMiniSync(),
-                                      output_file, bandwidth, min_ping);
+                                      output_file, bandwidth, min_ping, timestamps, trace_file);
+    }
+    else if (modes.front()->get_name() == "BENCH_MODE")
+    {
+        load = new MiniSync::LoadGenerator(peer, port, clients, duration, threads);
+        int status = 0;
+        try
+        {
+            MiniSync::LoadGenerator::Results results = load->run();
+            std::cout << "Clients: " << results.clients
+                      << " | Replies: " << results.replies << " (" << results.replies_per_sec << "/s)"
+                      << " | Lost: " << results.lost
+                      << " | Latency (µs): p50 " << results.latency_p50
+                      << ", p99 " << results.latency_p99
+                      << ", max " << results.latency_max << std::endl;
+        }
+        catch (std::exception& e)
+        {
+            // e.g. the handshakes timed out; scripts running benchmarks need to know the results are missing
+            LOG_F(ERROR, "%s", e.what());
+            status = 1;
+        }
+
+        delete (load);
+        return status;
     }
     else
         ABORT_F("Invalid mode specified for application - THIS SHOULD NEVER HAPPEN?");
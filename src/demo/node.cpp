@@ -8,6 +8,15 @@
 #include <utility>
 #include <cstring>
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <net/if.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <linux/errqueue.h>
+#include <linux/ethtool.h>
+#include <linux/net_tstamp.h>
+#include <linux/sockios.h>
 #include <protocol.pb.h>
 #include <google/protobuf/message.h>
 #include <thread>
@@ -17,18 +26,41 @@
 #include "exception.h"
 //#include "algorithms/constraints.h"
 
-#ifdef __x86_64__
-#define PRISIZE_T PRIu64
-#else
-#define PRISIZE_T PRId32
-#endif
+static google::protobuf::ArenaOptions arena_options(char* block, size_t len)
+{
+    google::protobuf::ArenaOptions options{};
+    options.initial_block = block;
+    options.initial_block_size = len;
+    return options;
+}
+
+MiniSync::ReusableMsg::ReusableMsg() :
+    arena(arena_options(this->block, BLOCK_LEN)), msg(nullptr)
+{
+    this->reset();
+}
 
-MiniSync::Node::Node(uint16_t bind_port, MiniSync::Protocol::NodeMode mode) :
-    bind_port(bind_port), local_addr(SOCKADDR{}), mode(mode), running(true)
+MiniSync::Protocol::MiniSyncMsg& MiniSync::ReusableMsg::reset()
+{
+    // the previous message and its payload go away with everything else on the arena
+    this->arena.Reset();
+    this->msg = google::protobuf::Arena::CreateMessage<MiniSync::Protocol::MiniSyncMsg>(&this->arena);
+    return *this->msg;
+}
+
+MiniSync::Node::Node(uint16_t bind_port,
+                     MiniSync::Protocol::NodeMode mode,
+                     const TimestampOptions& timestamps,
+                     bool reuse_port) :
+    bind_port(bind_port), local_addr(SOCKADDR{}), mode(mode), running(true), timestamps(timestamps),
+    hw_clock(-1), hw_clock_fd(-1), tx_timestamp_fd(-1), tx_count(0), unstamped(0)
 {
     this->sock_fd = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
     int enable = 1;
     setsockopt(this->sock_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int));
+    if (reuse_port)
+        CHECK_EQ_F(setsockopt(this->sock_fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(int)), 0,
+                   "Failed setting SO_REUSEPORT option for socket.");
 
     memset(&this->local_addr, 0, sizeof(this->local_addr));
     this->local_addr.sin_family = AF_INET;
@@ -42,7 +74,23 @@ MiniSync::Node::Node(uint16_t bind_port, MiniSync::Protocol::NodeMode mode) :
                "Failed to bind socket to UDP port %"
                    PRIu16, bind_port);
 
-    // estimate minimum possible delay by looping messages on the loopback interface
+    if (this->timestamps.kernel)
+    {
+        // kernel timestamps don't include the delays through the network stack, so there's nothing to estimate
+        if (!this->timestamps.hw_interface.empty())
+            this->init_hw_timestamps(this->timestamps.hw_interface);
+        // only sync nodes need transmit timestamps, references send their reply time in the reply itself
+        this->enable_kernel_timestamps(this->sock_fd, mode == MiniSync::Protocol::NodeMode::SYNC);
+    }
+    else this->estimate_minimum_delays();
+}
+
+/*
+ * Estimates the minimum delays through the local network stack, by looping messages on the loopback interface.
+ */
+void MiniSync::Node::estimate_minimum_delays()
+{
+    int enable = 1;
     int loop_in_fd = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
     int loop_out_fd = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
     uint16_t loopback_port = 5555; // TODO: Parametrize hardcoded port
@@ -176,27 +224,61 @@ MiniSync::Node::~Node()
     LOG_F(WARNING, "Shutting down, bye bye!");
     if (this->running.load())
         this->shut_down();
+    if (this->hw_clock_fd >= 0)
+        close(this->hw_clock_fd);
     // shutdown(this->sock_fd, SHUT_RDWR);
     // close(this->sock_fd);
 }
 
+uint64_t MiniSync::Node::get_unstamped() const
+{
+    return this->unstamped.load(std::memory_order_relaxed);
+}
+
 MiniSync::us_t
-MiniSync::Node::send_message(MiniSync::Protocol::MiniSyncMsg& msg, const sockaddr* dest)
+MiniSync::Node::send_message(const MiniSync::Protocol::MiniSyncMsg& msg, const sockaddr* dest)
 {
-    size_t out_sz = msg.ByteSize();
-    uint8_t reply_buf[out_sz];
-    msg.SerializeToArray(reply_buf, out_sz);
+    return this->send_message(this->sock_fd, msg, dest, this->tx_buffer);
+}
+
+MiniSync::us_t
+MiniSync::Node::recv_message(MiniSync::Protocol::MiniSyncMsg& msg, struct sockaddr* reply_to)
+{
+    us_t timestamp;
+    if (!this->try_recv_message(this->sock_fd, msg, reply_to, this->rx_buffer, timestamp))
+    {
+        DLOG_F(WARNING, "Timed out waiting for messages.");
+        throw MiniSync::Exceptions::TimeoutException();
+    }
+    return timestamp;
+}
+
+MiniSync::us_t
+MiniSync::Node::send_message(int fd,
+                             const MiniSync::Protocol::MiniSyncMsg& msg,
+                             const sockaddr* dest,
+                             Datagram& buffer)
+{
+    size_t out_sz = msg.ByteSizeLong();
+    if (out_sz > MSG_BUF_LEN || !msg.SerializeToArray(buffer.data, MSG_BUF_LEN))
+    {
+        DLOG_F(WARNING, "Failed to serialize message.");
+        throw MiniSync::Exceptions::SerializeMsgException();
+    }
 
     DLOG_F(INFO, "Sending a message of size %"
         PRISIZE_T
         " bytes...", out_sz);
 
     us_t timestamp = std::chrono::steady_clock::now() - start; // timestamp BEFORE passing on to network stack
-    if (sendto(this->sock_fd, reply_buf, out_sz, 0, dest, sizeof(*dest)) != out_sz)
+    if (sendto(fd, buffer.data, out_sz, 0, dest, sizeof(*dest)) != out_sz)
     {
         DLOG_F(WARNING, "Could not write to socket.");
         throw MiniSync::Exceptions::SocketWriteException();
     }
+    // when it actually left, if we get to know it
+    if (fd == this->tx_timestamp_fd && !this->tx_timestamp(fd, timestamp))
+        this->unstamped.fetch_add(1, std::memory_order_relaxed);
 
     DLOG_F(INFO, "Sent a message of size %"
         PRISIZE_T
@@ -204,10 +286,12 @@ MiniSync::Node::send_message(MiniSync::Protocol::MiniSyncMsg& msg, const sockadd
     return timestamp;
 }
 
-MiniSync::us_t
-MiniSync::Node::recv_message(MiniSync::Protocol::MiniSyncMsg& msg, struct sockaddr* reply_to)
+bool MiniSync::Node::try_recv_message(int fd,
+                                      MiniSync::Protocol::MiniSyncMsg& msg,
+                                      struct sockaddr* reply_to,
+                                      Datagram& buffer,
+                                      us_t& timestamp)
 {
-    uint8_t buf[MAX_MSG_LEN] = {0x00};
     ssize_t recv_sz;
     socklen_t reply_to_len = sizeof(struct sockaddr_in);
     msg.Clear();
@@ -216,28 +300,37 @@ MiniSync::Node::recv_message(MiniSync::Protocol::MiniSyncMsg& msg, struct sockad
     if (reply_to != nullptr)
         memset(reply_to, 0x00, reply_to_len);
 
-    if ((recv_sz = recvfrom(this->sock_fd, buf, MAX_MSG_LEN, 0, reply_to, &reply_to_len)) < 0)
+    // like recvfrom, but also getting the timestamp control messages
+    struct iovec iov{buffer.data, MSG_BUF_LEN};
+    struct msghdr header{};
+    header.msg_name = reply_to;
+    header.msg_namelen = reply_to != nullptr ? reply_to_len : 0;
+    header.msg_iov = &iov;
+    header.msg_iovlen = 1;
+    header.msg_control = buffer.control;
+    header.msg_controllen = sizeof(buffer.control);
+
+    if ((recv_sz = recvmsg(fd, &header, 0)) < 0)
     {
-        if (errno == EAGAIN || errno == EWOULDBLOCK)
-        {
-            DLOG_F(WARNING, "Timed out waiting for messages.");
-            throw MiniSync::Exceptions::TimeoutException();
-        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return false;
         else throw MiniSync::Exceptions::SocketReadException();
     }
 
-    us_t timestamp = std::chrono::steady_clock::now() - start; // timestamp after receiving whole message
+    timestamp = std::chrono::steady_clock::now() - start; // timestamp after receiving whole message
+    // or when the kernel got it, if it timestamped it
+    if (this->timestamps.kernel && !this->rx_timestamp(header, timestamp))
+        this->unstamped.fetch_add(1, std::memory_order_relaxed);
 
     DLOG_F(INFO, "Got %"
         PRISIZE_T
         " bytes of data at time %Lf µs.", recv_sz, timestamp.count());
-    // deserialize buffer into a protobuf message
-    if (!msg.ParseFromArray(buf, recv_sz))
+    // deserialize buffer into a protobuf message; anything longer than the buffer is not one of ours
+    if ((header.msg_flags & MSG_TRUNC) || !msg.ParseFromArray(buffer.data, static_cast<int>(recv_sz)))
     {
         DLOG_F(WARNING, "Failed to deserialize payload.");
         throw MiniSync::Exceptions::DeserializeMsgException();
     }
-    return timestamp;
+    return true;
 }
 
 void MiniSync::Node::shut_down()
@@ -248,6 +341,275 @@ void MiniSync::Node::shut_down()
     close(this->sock_fd);
 }
 
+/*
+ * Dynamic POSIX clock of a PTP hardware clock device, see FD_TO_CLOCKID in the kernel documentation.
+ */
+static clockid_t fd_to_clockid(int fd)
+{
+    return static_cast<clockid_t>((~static_cast<unsigned int>(fd) << 3u) | 3u);
+}
+
+void MiniSync::Node::init_hw_timestamps(const std::string& interface)
+{
+    struct ifreq ifr{};
+    strncpy(ifr.ifr_name, interface.c_str(), IFNAMSIZ - 1);
+
+    // find the clock the NIC timestamps datagrams with
+    struct ethtool_ts_info info{};
+    info.cmd = ETHTOOL_GET_TS_INFO;
+    ifr.ifr_data = reinterpret_cast<char*>(&info);
+    if (ioctl(this->sock_fd, SIOCETHTOOL, &ifr) < 0 || info.phc_index < 0 ||
+        !(info.so_timestamping & SOF_TIMESTAMPING_RAW_HARDWARE))
+    {
+        LOG_F(WARNING, "%s does not support hardware timestamps, using software timestamps.", interface.c_str());
+        return;
+    }
+
+    // have it timestamp every datagram it sends and receives
+    struct hwtstamp_config config{};
+    config.tx_type = HWTSTAMP_TX_ON;
+    config.rx_filter = HWTSTAMP_FILTER_ALL;
+    ifr.ifr_data = reinterpret_cast<char*>(&config);
+    if (ioctl(this->sock_fd, SIOCSHWTSTAMP, &ifr) < 0 || config.rx_filter == HWTSTAMP_FILTER_NONE)
+    {
+        LOG_F(WARNING, "Could not enable hardware timestamps on %s (ERRNO: %s), using software timestamps.",
+              interface.c_str(), strerror(errno));
+        return;
+    }
+
+    std::string device = "/dev/ptp" + std::to_string(info.phc_index);
+    if ((this->hw_clock_fd = open(device.c_str(), O_RDONLY)) < 0)
+    {
+        LOG_F(WARNING, "Could not open %s (ERRNO: %s), using software timestamps.", device.c_str(), strerror(errno));
+        return;
+    }
+    this->hw_clock = fd_to_clockid(this->hw_clock_fd);
+    LOG_F(INFO, "Using hardware timestamps from %s (%s).", interface.c_str(), device.c_str());
+}
+
+void MiniSync::Node::enable_kernel_timestamps(int fd, bool transmit)
+{
+    const bool hardware = this->hw_clock != -1;
+    unsigned int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (hardware)
+        flags |= SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+    if (transmit)
+    {
+        // only the timestamps, without the datagrams, numbered in the order they were sent
+        flags |= SOF_TIMESTAMPING_OPT_TSONLY | SOF_TIMESTAMPING_OPT_ID;
+        flags |= hardware ? SOF_TIMESTAMPING_TX_HARDWARE : SOF_TIMESTAMPING_TX_SOFTWARE;
+        this->tx_timestamp_fd = fd;
+        this->tx_count = 0;
+    }
+    CHECK_EQ_F(setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)), 0,
+               "Failed setting SO_TIMESTAMPING option for socket. ERRNO: %s", strerror(errno));
+}
+
+/*
+ * Kernel timestamps are on the system clock, or on the clock of the NIC, so they're converted through the offset
+ * between that clock and the steady clock, which stays practically constant during the time it takes to read both.
+ */
+MiniSync::us_t MiniSync::Node::to_local_time(const struct timespec& ts, clockid_t clock) const
+{
+    struct timespec clock_now{};
+    clock_gettime(clock, &clock_now);
+    us_t now = std::chrono::steady_clock::now() - this->start;
+    return now - (std::chrono::seconds{clock_now.tv_sec - ts.tv_sec} +
+                  std::chrono::nanoseconds{clock_now.tv_nsec - ts.tv_nsec});
+}
+
+bool MiniSync::Node::rx_timestamp(struct msghdr& header, us_t& timestamp) const
+{
+    bool found = false;
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&header); cmsg != nullptr; cmsg = CMSG_NXTHDR(&header, cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET) continue;
+        if (cmsg->cmsg_type == SCM_TIMESTAMPING)
+        {
+            // software timestamp first, the one by the NIC (if any) last
+            struct scm_timestamping stamps{};
+            memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+            if (this->hw_clock != -1 && (stamps.ts[2].tv_sec != 0 || stamps.ts[2].tv_nsec != 0))
+            {
+                timestamp = this->to_local_time(stamps.ts[2], this->hw_clock);
+                return true;
+            }
+            if (stamps.ts[0].tv_sec != 0 || stamps.ts[0].tv_nsec != 0)
+            {
+                timestamp = this->to_local_time(stamps.ts[0], CLOCK_REALTIME);
+                found = true;
+            }
+        }
+        else if (cmsg->cmsg_type == SCM_TIMESTAMPNS && !found)
+        {
+            struct timespec ts{};
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            timestamp = this->to_local_time(ts, CLOCK_REALTIME);
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool MiniSync::Node::tx_timestamp(int fd, us_t& timestamp)
+{
+    const uint32_t id = this->tx_count++; // the number of the datagram we're waiting for
+    union
+    {
+        struct cmsghdr align;
+        uint8_t buf[CMSG_SPACE(sizeof(struct scm_timestamping)) +
+                    CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(SOCKADDR))];
+    } control{};
+    struct pollfd error_queue{fd, 0, 0}; // POLLERR is always reported
+
+    // the timestamp is usually there within microseconds (much earlier than any reply), don't wait for too long
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(1);
+    for (;;)
+    {
+        struct msghdr header{};
+        header.msg_control = control.buf;
+        header.msg_controllen = sizeof(control.buf);
+        if (recvmsg(fd, &header, MSG_ERRQUEUE) < 0)
+        {
+            if ((errno != EAGAIN && errno != EWOULDBLOCK) || std::chrono::steady_clock::now() >= deadline)
+            {
+                DLOG_F(WARNING, "No transmit timestamp for datagram %" PRIu32 ".", id);
+                return false;
+            }
+            poll(&error_queue, 1, 1);
+            continue;
+        }
+
+        bool found = false;
+        bool matches = false;
+        struct timespec ts{};
+        clockid_t clock = CLOCK_REALTIME;
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&header); cmsg != nullptr; cmsg = CMSG_NXTHDR(&header, cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING)
+            {
+                struct scm_timestamping stamps{};
+                memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+                bool hardware = this->hw_clock != -1 && (stamps.ts[2].tv_sec != 0 || stamps.ts[2].tv_nsec != 0);
+                ts = hardware ? stamps.ts[2] : stamps.ts[0];
+                clock = hardware ? this->hw_clock : CLOCK_REALTIME;
+                found = ts.tv_sec != 0 || ts.tv_nsec != 0;
+            }
+            else if (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR)
+            {
+                struct sock_extended_err err{};
+                memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+                matches = err.ee_origin == SO_EE_ORIGIN_TIMESTAMPING && err.ee_data == id;
+            }
+        }
+
+        // otherwise it's the late timestamp of an earlier datagram
+        if (found && matches)
+        {
+            timestamp = this->to_local_time(ts, clock);
+            return true;
+        }
+    }
+}
+
+void MiniSync::Node::init_batch_io(int fd, uint32_t batch_size, Batch& rx_batch, Batch& tx_batch)
+{
+    for (Batch* batch : {&rx_batch, &tx_batch})
+    {
+        // sized once, so that the headers can point into the datagrams
+        batch->datagrams.resize(batch_size);
+        batch->headers.resize(batch_size);
+        batch->iovecs.resize(batch_size);
+        for (uint32_t i = 0; i < batch_size; ++i)
+        {
+            Datagram& datagram = batch->datagrams[i];
+            struct msghdr& header = batch->headers[i].msg_hdr;
+            memset(&header, 0, sizeof(header));
+            batch->iovecs[i].iov_base = datagram.data;
+            header.msg_name = &datagram.addr;
+            header.msg_iov = &batch->iovecs[i];
+            header.msg_iovlen = 1;
+        }
+    }
+
+    // have the kernel timestamp incoming datagrams, as they may wait in the socket buffer until their batch is read
+    int enable = 1;
+    CHECK_EQ_F(setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)), 0,
+               "Failed setting SO_TIMESTAMPNS option for socket.");
+}
+
+uint32_t MiniSync::Node::recv_batch(int fd, Batch& batch)
+{
+    const auto batch_size = static_cast<unsigned int>(batch.headers.size());
+    for (uint32_t i = 0; i < batch_size; ++i)
+    {
+        // the kernel overwrites these on every call
+        struct msghdr& header = batch.headers[i].msg_hdr;
+        header.msg_namelen = sizeof(SOCKADDR);
+        header.msg_control = batch.datagrams[i].control;
+        header.msg_controllen = sizeof(batch.datagrams[i].control);
+        batch.iovecs[i].iov_len = MSG_BUF_LEN;
+    }
+
+    int received = recvmmsg(fd, batch.headers.data(), batch_size, MSG_DONTWAIT, nullptr);
+    if (received < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+        else throw MiniSync::Exceptions::SocketReadException();
+    }
+
+    us_t now = std::chrono::steady_clock::now() - start;
+    for (int i = 0; i < received; ++i)
+    {
+        Datagram& datagram = batch.datagrams[i];
+        struct msghdr& header = batch.headers[i].msg_hdr;
+        // too long to be one of our messages
+        datagram.len = (header.msg_flags & MSG_TRUNC) ? 0 : batch.headers[i].msg_len;
+        if (!this->rx_timestamp(header, datagram.timestamp))
+        {
+            datagram.timestamp = now; // only if the kernel didn't timestamp it
+            this->unstamped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    DLOG_F(INFO, "Got a batch of %d datagrams.", received);
+    return static_cast<uint32_t>(received);
+}
+
+uint32_t MiniSync::Node::send_batch(int fd, Batch& batch, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        struct msghdr& header = batch.headers[i].msg_hdr;
+        header.msg_namelen = sizeof(SOCKADDR);
+        batch.iovecs[i].iov_len = batch.datagrams[i].len;
+    }
+
+    uint32_t next = 0; // first datagram not tried yet
+    uint32_t sent = 0;
+    while (next < count)
+    {
+        int n = sendmmsg(fd, batch.headers.data() + next, count - next, 0);
+        if (n < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                // send buffer is full, the clients will time out and retry
+                DLOG_F(WARNING, "Could not write to socket, dropping %" PRIu32 " datagrams.", count - next);
+                break;
+            }
+            // only the first datagram failed (e.g. EPERM, ENETUNREACH), drop it and go on with the rest
+            DLOG_F(WARNING, "Could not write to socket. ERRNO: %s", strerror(errno));
+            next++;
+            continue;
+        }
+        if (n == 0) break;
+        next += n;
+        sent += n;
+    }
+    return sent;
+}
+
 void MiniSync::SyncNode::run()
 {
     this->handshake();
@@ -255,19 +617,67 @@ void MiniSync::SyncNode::run()
 }
 
 /*
- * Simply listens for incoming beacons and replies accordingly.
+ * Simply listens for incoming handshakes and beacons from any number of clients and replies accordingly.
  */
 void MiniSync::ReferenceNode::run()
 {
-    this->wait_for_handshake();
-    this->serve();
+    this->start = std::chrono::steady_clock::now(); // start counting time, for all clients and workers
+    if (this->workers.size() == 1)
+        this->serve(*this->workers.front());
+    else
+    {
+        for (auto& worker : this->workers)
+        {
+            Worker* w = worker.get();
+            w->thread = std::thread([this, w]()
+                                    {
+                                        try
+                                        {
+                                            this->serve(*w);
+                                        }
+                                        catch (...)
+                                        {
+                                            // stop the other workers too, run() rethrows it once they're done
+                                            w->error = std::current_exception();
+                                            this->running.store(false);
+                                        }
+                                    });
+            if (w->cpu < 0) continue;
+
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(w->cpu, &cpus);
+            if (pthread_setaffinity_np(w->thread.native_handle(), sizeof(cpus), &cpus) != 0)
+                LOG_F(WARNING, "Could not pin worker to CPU %d.", w->cpu);
+        }
+        for (auto& worker : this->workers)
+            worker->thread.join();
+    }
+
+    Counters counters = this->get_counters();
+    LOG_F(INFO, "Served %" PRIu64 " clients: %" PRIu64 " beacons and %" PRIu64 " handshakes answered, "
+                "%" PRIu64 " messages ignored, %" PRIu64 " replies dropped.",
+          counters.clients, counters.beacons, counters.handshakes, counters.ignored, counters.dropped);
+    if (this->get_unstamped() > 0)
+        LOG_F(WARNING, "%" PRIu64 " datagrams were not timestamped by the kernel.", this->get_unstamped());
+
+    for (auto& worker : this->workers)
+        if (worker->error) std::rethrow_exception(worker->error);
+}
+
+/*
+ * Workers may be reading from their sockets at any time until they notice, so closing them here could make the reads
+ * fail, or even let another socket take over the descriptor in the meantime.
+ */
+void MiniSync::ReferenceNode::shut_down()
+{
+    this->running.store(false);
 }
 
 void MiniSync::SyncNode::handshake()
 {
     // send handshake request to peer
     MiniSync::Protocol::MiniSyncMsg msg{};
-    msg.set_allocated_handshake(new MiniSync::Protocol::Handshake{});
     msg.mutable_handshake()->set_mode(this->mode);
     msg.mutable_handshake()->set_version_major(PROTOCOL_VERSION_MAJOR);
     msg.mutable_handshake()->set_version_minor(PROTOCOL_VERSION_MINOR);
@@ -333,8 +743,10 @@ void MiniSync::SyncNode::handshake()
 
 void MiniSync::SyncNode::sync()
 {
-    // send sync beacons and wait for timestamps
-    MiniSync::Protocol::MiniSyncMsg msg{};
+    // send sync beacons and wait for timestamps; the same beacon is sent every time, with a new sequence number
+    MiniSync::Protocol::MiniSyncMsg beacon{};
+    beacon.mutable_beacon();
+    MiniSync::ReusableMsg incoming{};
 
     us_t to, tbr, tbt, tr;
     uint8_t seq = 0;
@@ -345,9 +757,8 @@ void MiniSync::SyncNode::sync()
     while (this->running.load())
     {
         auto t_i = std::chrono::steady_clock::now();
-        msg.set_allocated_beacon(new MiniSync::Protocol::Beacon{});
-        msg.mutable_beacon()->set_seq(seq);
-        send_sz = msg.ByteSizeLong();
+        beacon.mutable_beacon()->set_seq(seq);
+        send_sz = beacon.ByteSizeLong();
 
         LOG_F(INFO, "Sending beacon (SEQ %"
             PRIu8
@@ -358,11 +769,12 @@ void MiniSync::SyncNode::sync()
         try
         {
             // nullptr since we should already be connected
-            to = this->send_message(msg, nullptr);
+            to = this->send_message(beacon, nullptr);
 
             for (;;)
             {
                 // wait for reply without resending to avoid ugly feedback loops
+                MiniSync::Protocol::MiniSyncMsg& msg = incoming.reset();
                 tr = this->recv_message(msg, nullptr);
                 recv_sz = msg.ByteSizeLong();
 
@@ -419,6 +831,10 @@ void MiniSync::SyncNode::sync()
         to += min_uplink_delay;
         tr -= min_downlink_delay;
 
+        if (this->trace)
+            this->trace->write(Trace::TraceRecord{Trace::toNanoseconds(to), Trace::toNanoseconds(tbr),
+                                                  Trace::toNanoseconds(tbt), Trace::toNanoseconds(tr)});
+
         // add data points
         this->algo->addDataPoint(to, tbr, tr);
         this->algo->addDataPoint(to, tbt, tr);
@@ -428,19 +844,17 @@ void MiniSync::SyncNode::sync()
         auto offset = algo->getOffset();
         auto offset_error = algo->getOffsetError();
 
-        auto
-            adj_timestamp =
-            std::chrono::duration_cast<us_t>(algo->getCurrentAdjustedTime().time_since_epoch());
+        // local timestamps are relative to start, which getCurrentAdjustedTime() doesn't know about
+        auto adj_timestamp = API::toReference(algo->getEstimates(), std::chrono::steady_clock::now() - this->start);
 
         LOG_F(INFO, "Current adjusted timestamp: %Lf µs", adj_timestamp.count());
         LOG_F(INFO, "Drift: %Lf | Error: +/- %Lf", drift, drift_error);
         LOG_F(INFO, "Offset: %Lf µs | Error: +/- %Lf µs", offset.count(), offset_error.count());
 
-        stats.add_sample(offset.count(), offset_error.count(), drift, drift_error);
+        if (!this->stat_file_path.empty())
+            this->stats.add_sample(offset.count(), offset_error.count(), drift, drift_error);
 
         seq++;
-        msg.Clear();
-        // msg handles clearing beacon
         auto t_f = std::chrono::steady_clock::now();
         std::this_thread::sleep_for(std::chrono::milliseconds(100) - (t_f - t_i)); // TODO: parameterize
     }
@@ -452,14 +866,16 @@ MiniSync::SyncNode::SyncNode(uint16_t bind_port,
                              std::shared_ptr<MiniSync::API::Algorithm>&& sync_algo,
                              std::string stat_file_path,
                              double bandwidth_mbps,
-                             double min_ping_rtt_ms) :
-    Node(bind_port, MiniSync::Protocol::NodeMode::SYNC),
+                             double min_ping_rtt_ms,
+                             const TimestampOptions& timestamps,
+                             const std::string& trace_file_path) :
+    Node(bind_port, MiniSync::Protocol::NodeMode::SYNC, timestamps),
     algo(std::move(sync_algo)), // take ownership of algorithm
     peer(peer),
     peer_port(peer_port),
     peer_addr({}),
-    stats({}),
-    stat_file_path(std::move(stat_file_path))
+    stat_file_path(std::move(stat_file_path)),
+    stats(this->stat_file_path.empty() ? 0 : MiniSync::Stats::SyncStats::INIT_VEC_SIZE) // only kept for the file
 {
     LOG_F(INFO, "Initializing SyncNode.");
     // set up peer addr
@@ -491,6 +907,19 @@ MiniSync::SyncNode::SyncNode(uint16_t bind_port,
     // ping rtt
     // we multiply it by a factor of 0.9 since we want the absolute minimum with a bit of leeway as well
     this->min_ping_oneway_us = min_ping_rtt_ms > 0 ? us_t{min_ping_rtt_ms * 1000.0 / 2.0 * 0.9} : us_t{-1.0};
+
+    // exchanges as fed to the algorithm, for minisync_replay
+    if (!trace_file_path.empty())
+    {
+        try
+        {
+            this->trace.reset(new Trace::Writer(trace_file_path));
+        }
+        catch (std::runtime_error& e)
+        {
+            ABORT_F("%s", e.what());
+        }
+    }
 }
 
 MiniSync::SyncNode::~SyncNode()
@@ -501,144 +930,356 @@ MiniSync::SyncNode::~SyncNode()
     }
 }
 
-void MiniSync::ReferenceNode::serve()
+const uint32_t MiniSync::ReferenceNode::CLIENT_TIMEOUT_SEC;
+const int MiniSync::ReferenceNode::POLL_TIMEOUT_MSEC;
+const uint32_t MiniSync::ReferenceNode::DEFAULT_BATCH_SIZE;
+const uint32_t MiniSync::ReferenceNode::MAX_BATCH_SIZE;
+const uint32_t MiniSync::ReferenceNode::MAX_WORKERS;
+
+uint64_t MiniSync::ReferenceNode::client_key(const SOCKADDR& addr)
+{
+    return (static_cast<uint64_t>(addr.sin_addr.s_addr) << 16u) | addr.sin_port;
+}
+
+/*
+ * Counters only have one writer, so they don't need atomic increments.
+ */
+void MiniSync::ReferenceNode::count(std::atomic<uint64_t>& counter, uint64_t n)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+MiniSync::ReferenceNode::Counters MiniSync::ReferenceNode::get_counters() const
+{
+    Counters total{};
+    for (const auto& worker : this->workers)
+    {
+        total.clients += worker->counters.clients.load(std::memory_order_relaxed);
+        total.received += worker->counters.received.load(std::memory_order_relaxed);
+        total.beacons += worker->counters.beacons.load(std::memory_order_relaxed);
+        total.handshakes += worker->counters.handshakes.load(std::memory_order_relaxed);
+        total.ignored += worker->counters.ignored.load(std::memory_order_relaxed);
+        total.dropped += worker->counters.dropped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void MiniSync::ReferenceNode::serve(Worker& worker)
 {
     // set up variables
-    us_t recv_time;
+    struct epoll_event event{};
+    auto last_cleanup = std::chrono::steady_clock::now();
 
-    MiniSync::Protocol::MiniSyncMsg incoming{};
-    MiniSync::Protocol::MiniSyncMsg outgoing{};
+    MiniSync::ReusableMsg incoming{};
+    MiniSync::ReusableMsg outgoing{};
+
+    LOG_F(INFO, "Listening for incoming handshakes and beacons.");
+    while (this->running.load())
+    {
+        // wait for the socket to become readable; time out regularly to check if we've been shut down
+        int ready = epoll_wait(worker.epoll_fd, &event, 1, MiniSync::ReferenceNode::POLL_TIMEOUT_MSEC);
+        if (ready < 0 && errno != EINTR)
+        {
+            LOG_F(ERROR, "Call to epoll_wait failed. ERRNO: %s", strerror(errno));
+            throw MiniSync::Exceptions::SocketReadException();
+        }
+
+        if (ready > 0)
+        {
+            if (this->batch_size > 1) this->drain_batched(worker, incoming, outgoing);
+            else this->drain(worker, incoming, outgoing);
+        }
+
+        if (std::chrono::steady_clock::now() - last_cleanup >
+            std::chrono::seconds(MiniSync::ReferenceNode::CLIENT_TIMEOUT_SEC))
+        {
+            this->forget_idle_clients(worker);
+            last_cleanup = std::chrono::steady_clock::now();
+        }
+    }
+}
+
+/*
+ * Reads and answers messages one by one until the socket is empty. The socket is non-blocking.
+ */
+void MiniSync::ReferenceNode::drain(Worker& worker, ReusableMsg& incoming, ReusableMsg& outgoing)
+{
+    us_t recv_time;
+    SOCKADDR client_addr{};
+    char addr_str[INET_ADDRSTRLEN] = {0x00};
 
-    // wait for beacons
     while (this->running.load())
     {
-        // timestamp reception
-        LOG_F(INFO, "Listening for incoming beacons.");
+        MiniSync::Protocol::MiniSyncMsg& msg = incoming.reset();
         try
         {
-            recv_time = this->recv_message(incoming, nullptr);
+            if (!this->try_recv_message(worker.sock_fd, msg, (struct sockaddr*) &client_addr, worker.rx_buffer,
+                                        recv_time))
+                break; // nothing left to read
+            count(worker.counters.received);
+        }
+        catch (MiniSync::Exceptions::DeserializeMsgException& e)
+        {
+            // could not parse incoming message, just ignore it
+            LOG_F(WARNING, "Could not deserialize incoming message, ignoring...");
+            count(worker.counters.received);
+            count(worker.counters.ignored);
+            continue;
+        }
+
+        MiniSync::Protocol::MiniSyncMsg& reply = outgoing.reset();
+        if (!this->handle(worker, msg, recv_time, client_addr, reply)) continue;
+        try
+        {
+            this->send_message(worker.sock_fd, reply, (struct sockaddr*) &client_addr, worker.tx_buffer);
+        }
+        catch (MiniSync::Exceptions::SocketWriteException& e)
+        {
+            // e.g. the send buffer is full; the client will time out and retry
+            LOG_F(WARNING, "Could not send reply to %s:%" PRIu16 ", dropping it...",
+                  inet_ntop(AF_INET, &client_addr.sin_addr, addr_str, sizeof(addr_str)),
+                  ntohs(client_addr.sin_port));
+            count(worker.counters.dropped);
+        }
+    }
+}
 
-            if (incoming.has_beacon())
+/*
+ * Same as drain(), but reads a batch of messages at once and answers all of them at once.
+ */
+void MiniSync::ReferenceNode::drain_batched(Worker& worker, ReusableMsg& incoming, ReusableMsg& outgoing)
+{
+    uint32_t received;
+    while (this->running.load() && (received = this->recv_batch(worker.sock_fd, worker.rx_batch)) > 0)
+    {
+        count(worker.counters.received, received);
+        uint32_t replies = 0;
+        for (uint32_t i = 0; i < received; ++i)
+        {
+            const Datagram& in = worker.rx_batch.datagrams[i];
+            MiniSync::Protocol::MiniSyncMsg& msg = incoming.reset();
+            if (!msg.ParseFromArray(in.data, static_cast<int>(in.len)))
             {
-                // got beacon, so just reply
-                const MiniSync::Protocol::Beacon& beacon = incoming.beacon();
-                outgoing.set_allocated_beacon_r(new MiniSync::Protocol::BeaconReply{});
-                outgoing.mutable_beacon_r()->set_seq(beacon.seq());
-                outgoing.mutable_beacon_r()->set_beacon_recv_time(
-                    std::chrono::duration_cast<std::chrono::nanoseconds>(
-                        recv_time - this->minimum_delays.beacon).count()); // adjust with minimum delays
-
-                LOG_F(INFO, "Received a beacon (SEQ %"
-                    PRIu8
-                    ").", beacon.seq());
-
-                outgoing.mutable_beacon_r()->set_reply_send_time(
-                    std::chrono::duration_cast<std::chrono::nanoseconds>(
-                        (std::chrono::steady_clock::now() - start) + this->minimum_delays.beacon_reply).count());
-
-                LOG_F(INFO, "Replying to beacon.");
-                this->send_message(outgoing, nullptr);
+                // could not parse incoming message, just ignore it
+                LOG_F(WARNING, "Could not deserialize incoming message, ignoring...");
+                count(worker.counters.ignored);
+                continue;
             }
-            else if (incoming.has_goodbye())
+            MiniSync::Protocol::MiniSyncMsg& reply = outgoing.reset();
+            if (!this->handle(worker, msg, in.timestamp, in.addr, reply)) continue;
+
+            // same checks as send_message(), the slot is only taken once the reply fits in it
+            Datagram& out = worker.tx_batch.datagrams[replies];
+            const size_t out_sz = reply.ByteSizeLong();
+            if (out_sz > MSG_BUF_LEN || !reply.SerializeToArray(out.data, MSG_BUF_LEN))
             {
-                // got goodbye, reply and shutdown
-                LOG_F(WARNING, "Got shutdown request.");
-                outgoing.set_allocated_goodbye_r(new MiniSync::Protocol::GoodByeReply{});
-                this->send_message(outgoing, nullptr);
-                this->running.store(false);
+                LOG_F(WARNING, "Failed to serialize reply, dropping it...");
+                count(worker.counters.dropped);
+                continue;
             }
-
-            // clean up after send
-            outgoing.Clear();
-            // no need to clear up reply, outgoing takes care of it
+            out.addr = in.addr;
+            out.len = out_sz;
+            ++replies;
         }
-        catch (MiniSync::Exceptions::DeserializeMsgException& e)
+        count(worker.counters.dropped, replies - this->send_batch(worker.sock_fd, worker.tx_batch, replies));
+    }
+}
+
+/*
+ * Handles a message from a client, and fills in the reply to send back, if there is one.
+ */
+bool MiniSync::ReferenceNode::handle(Worker& worker,
+                                     const MiniSync::Protocol::MiniSyncMsg& incoming,
+                                     us_t recv_time,
+                                     const SOCKADDR& client_addr,
+                                     MiniSync::Protocol::MiniSyncMsg& outgoing)
+{
+    char addr_str[INET_ADDRSTRLEN] = {0x00};
+    if (incoming.has_beacon())
+    {
+        auto client = worker.clients.find(client_key(client_addr));
+        if (client == worker.clients.end())
         {
-            // could not parse incoming message, just retry
-            LOG_F(WARNING, "Could not deserialize incoming message, retrying...");
-            continue;
+            LOG_F(WARNING, "Got a beacon from %s:%" PRIu16 ", which has not completed a handshake. Ignoring...",
+                  inet_ntop(AF_INET, &client_addr.sin_addr, addr_str, sizeof(addr_str)),
+                  ntohs(client_addr.sin_port));
+            count(worker.counters.ignored);
+            return false;
         }
+        client->second.last_seen = std::chrono::steady_clock::now();
+        client->second.beacons++;
+        count(worker.counters.beacons);
+
+        // got beacon, so just reply
+        const MiniSync::Protocol::Beacon& beacon = incoming.beacon();
+        outgoing.mutable_beacon_r()->set_seq(beacon.seq());
+        outgoing.mutable_beacon_r()->set_beacon_recv_time(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                recv_time - this->minimum_delays.beacon).count()); // adjust with minimum delays
+
+        DLOG_F(INFO, "Received a beacon (SEQ %" PRIu32 ") from %s:%" PRIu16 ".", beacon.seq(),
+               inet_ntop(AF_INET, &client_addr.sin_addr, addr_str, sizeof(addr_str)), ntohs(client_addr.sin_port));
+
+        outgoing.mutable_beacon_r()->set_reply_send_time(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                (std::chrono::steady_clock::now() - start) + this->minimum_delays.beacon_reply).count());
+        return true;
+    }
+    else if (incoming.has_handshake())
+    {
+        this->handshake(worker, incoming.handshake(), client_addr, outgoing);
+        count(worker.counters.handshakes);
+        return true;
     }
+    else if (incoming.has_goodbye())
+    {
+        // got goodbye, reply and forget the client
+        LOG_F(INFO, "Got goodbye from %s:%" PRIu16 ".",
+              inet_ntop(AF_INET, &client_addr.sin_addr, addr_str, sizeof(addr_str)), ntohs(client_addr.sin_port));
+        worker.clients.erase(client_key(client_addr));
+        worker.counters.clients.store(worker.clients.size(), std::memory_order_relaxed);
+        outgoing.mutable_goodbye_r();
+        return true;
+    }
+    count(worker.counters.ignored);
+    return false;
 }
 
-void MiniSync::ReferenceNode::wait_for_handshake()
+void MiniSync::ReferenceNode::handshake(Worker& worker,
+                                        const MiniSync::Protocol::Handshake& handshake,
+                                        const SOCKADDR& client_addr,
+                                        MiniSync::Protocol::MiniSyncMsg& outgoing)
 {
-    // set up variables
-    struct sockaddr reply_to{};
-    socklen_t reply_to_len = sizeof(reply_to);
+    char addr_str[INET_ADDRSTRLEN] = {0x00};
+    LOG_F(INFO, "Received handshake request from %s:%" PRIu16 ".",
+          inet_ntop(AF_INET, &client_addr.sin_addr, addr_str, sizeof(addr_str)), ntohs(client_addr.sin_port));
 
-    MiniSync::Protocol::MiniSyncMsg incoming{};
-    MiniSync::Protocol::MiniSyncMsg outgoing{};
+    using ReplyStatus = MiniSync::Protocol::HandshakeReply_Status;
 
-    // discard anything that is not a handshake request
-    bool listening = true;
-    while (listening && this->running.load())
+    if (PROTOCOL_VERSION_MAJOR != handshake.version_major() ||
+        PROTOCOL_VERSION_MINOR != handshake.version_minor())
     {
-        // wait for handshake
-        LOG_F(INFO, "Waiting for incoming handshake requests.");
-        try
+        LOG_F(WARNING, "Handshake: Version mismatch.");
+        LOG_F(WARNING, "Local version: %"
+            PRIu8
+            ".%"
+            PRIu8
+            " - Remote version: %"
+            PRIu8
+            ".%"
+            PRIu8,
+              PROTOCOL_VERSION_MAJOR, PROTOCOL_VERSION_MINOR,
+              handshake.version_major(), handshake.version_minor());
+        outgoing.mutable_handshake_r()->set_status(ReplyStatus::HandshakeReply_Status_VERSION_MISMATCH);
+    }
+    else if (handshake.mode() == this->mode)
+    {
+        LOG_F(WARNING, "Handshake: Mode mismatch.");
+        outgoing.mutable_handshake_r()->set_status(ReplyStatus::HandshakeReply_Status_MODE_MISMATCH);
+    }
+    else
+    {
+        // everything is ok, remember the client
+        // repeated handshakes (e.g. if our reply got lost) simply refresh it
+        LOG_F(INFO, "Handshake successful.");
+        outgoing.mutable_handshake_r()->set_status(ReplyStatus::HandshakeReply_Status_SUCCESS);
+        Client& client = worker.clients[client_key(client_addr)];
+        client.last_seen = std::chrono::steady_clock::now();
+        worker.counters.clients.store(worker.clients.size(), std::memory_order_relaxed);
+        LOG_F(INFO, "Serving %" PRISIZE_T " clients.", worker.clients.size());
+    }
+    // reply is sent by the caller no matter what
+}
+
+void MiniSync::ReferenceNode::forget_idle_clients(Worker& worker)
+{
+    auto deadline =
+        std::chrono::steady_clock::now() - std::chrono::seconds(MiniSync::ReferenceNode::CLIENT_TIMEOUT_SEC);
+    for (auto it = worker.clients.begin(); it != worker.clients.end();)
+    {
+        if (it->second.last_seen < deadline)
         {
-            this->recv_message(incoming, &reply_to);
-            if (incoming.has_handshake())
-            {
-                outgoing.set_allocated_handshake_r(new MiniSync::Protocol::HandshakeReply{});
-                LOG_F(INFO, "Received handshake request.");
-                using ReplyStatus = MiniSync::Protocol::HandshakeReply_Status;
-                const auto& handshake = incoming.handshake();
+            LOG_F(INFO, "Forgetting idle client after %" PRIu64 " beacons.", it->second.beacons);
+            it = worker.clients.erase(it);
+        }
+        else ++it;
+    }
+    worker.counters.clients.store(worker.clients.size(), std::memory_order_relaxed);
+}
 
-                if (PROTOCOL_VERSION_MAJOR != handshake.version_major() ||
-                    PROTOCOL_VERSION_MINOR != handshake.version_minor())
-                {
-                    LOG_F(WARNING, "Handshake: Version mismatch.");
-                    LOG_F(WARNING, "Local version: %"
-                        PRIu8
-                        ".%"
-                        PRIu8
-                        " - Remote version: %"
-                        PRIu8
-                        ".%"
-                        PRIu8,
-                          PROTOCOL_VERSION_MAJOR, PROTOCOL_VERSION_MINOR,
-                          handshake.version_major(), handshake.version_minor());
-                    outgoing.mutable_handshake_r()->set_status(ReplyStatus::HandshakeReply_Status_VERSION_MISMATCH);
-                }
-                else if (handshake.mode() == this->mode)
-                {
-                    LOG_F(WARNING, "Handshake: Mode mismatch.");
-                    outgoing.mutable_handshake_r()->set_status(ReplyStatus::HandshakeReply_Status_MODE_MISMATCH);
-                }
-                else
-                {
-                    // everything is ok, let's "connect"
-                    LOG_F(INFO, "Handshake successful.");
-                    outgoing.mutable_handshake_r()->set_status(ReplyStatus::HandshakeReply_Status_SUCCESS);
-                    // UDP is connectionless, this is merely to store the address of the client and "fake" a connection
-                    CHECK_GE_F(connect(this->sock_fd, &reply_to, reply_to_len), 0,
-                               "Call to connect failed. ERRNO: %s", strerror(errno));
-                    this->start = std::chrono::steady_clock::now(); // start counting time
-                    listening = false;
-                }
+MiniSync::ReferenceNode::ReferenceNode(uint16_t bind_port,
+                                       uint32_t batch_size,
+                                       uint32_t workers,
+                                       const TimestampOptions& timestamps) :
+    Node(bind_port, MiniSync::Protocol::NodeMode::REFERENCE, timestamps, workers > 1),
+    batch_size(batch_size > MAX_BATCH_SIZE ? MAX_BATCH_SIZE : (batch_size > 0 ? batch_size : 1))
+{
+    LOG_F(INFO, "Initializing ReferenceNode.");
+    workers = workers > MAX_WORKERS ? MAX_WORKERS : (workers > 0 ? workers : 1);
+    if (this->batch_size > 1)
+    {
+        LOG_F(INFO, "Reading and answering messages in batches of up to %" PRIu32 ".", this->batch_size);
+        // batches are always timestamped by the kernel on reception, before going up the network stack
+        this->minimum_delays.beacon = us_t{0};
+    }
 
-                // reply is sent no matter what
-                this->send_message(outgoing, &reply_to);
-                // TODO: verify the handshake is received??
+    // cores the workers can be pinned to, in order
+    std::vector<int> cpus;
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (workers > 1 && sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+    }
+    if (workers > cpus.size() && workers > 1)
+        LOG_F(WARNING, "More workers (%" PRIu32 ") than available cores (%" PRISIZE_T ").", workers, cpus.size());
 
-                // cleanup
-                outgoing.Clear();
-                // no need to clear reply, outgoing has ownership and will clear it
-            }
-        }
-        catch (MiniSync::Exceptions::DeserializeMsgException& e)
+    for (uint32_t i = 0; i < workers; ++i)
+    {
+        std::unique_ptr<Worker> worker{new Worker{}};
+        worker->cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+        if (i == 0) worker->sock_fd = this->sock_fd;
+        else
         {
-            // could not parse incoming message, just retry
-            LOG_F(WARNING, "Could not deserialize incoming message, retrying...");
-            continue;
+            // each worker gets its own socket on the same port, the kernel spreads the clients among them
+            worker->sock_fd = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+            int enable = 1;
+            setsockopt(worker->sock_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int));
+            CHECK_EQ_F(setsockopt(worker->sock_fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(int)), 0,
+                       "Failed setting SO_REUSEPORT option for socket.");
+            CHECK_GE_F(bind(worker->sock_fd, (struct sockaddr*) &this->local_addr, sizeof(this->local_addr)), 0,
+                       "Failed to bind socket to UDP port %" PRIu16, bind_port);
+            if (this->timestamps.kernel)
+                this->enable_kernel_timestamps(worker->sock_fd, false);
         }
+
+        // the socket stays unconnected, and non-blocking so the server loop can drain it after each wake up
+        int flags = fcntl(worker->sock_fd, F_GETFL, 0);
+        CHECK_GE_F(fcntl(worker->sock_fd, F_SETFL, flags | O_NONBLOCK), 0,
+                   "Failed setting socket to non-blocking mode. ERRNO: %s", strerror(errno));
+        if (this->batch_size > 1)
+            this->init_batch_io(worker->sock_fd, this->batch_size, worker->rx_batch, worker->tx_batch);
+
+        worker->epoll_fd = epoll_create1(0);
+        CHECK_GE_F(worker->epoll_fd, 0, "Call to epoll_create1 failed. ERRNO: %s", strerror(errno));
+        struct epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = worker->sock_fd;
+        CHECK_GE_F(epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->sock_fd, &event), 0,
+                   "Call to epoll_ctl failed. ERRNO: %s", strerror(errno));
+
+        this->workers.push_back(std::move(worker));
     }
 }
 
-MiniSync::ReferenceNode::ReferenceNode(uint16_t bind_port) :
-    Node(bind_port, MiniSync::Protocol::NodeMode::REFERENCE)
+MiniSync::ReferenceNode::~ReferenceNode()
 {
-    LOG_F(INFO, "Initializing ReferenceNode.");
+    this->running.store(false);
+    for (auto& worker : this->workers)
+    {
+        if (worker->thread.joinable()) worker->thread.join();
+        close(worker->epoll_fd);
+        close(worker->sock_fd); // including the socket of the node, for the first one
+    }
 }
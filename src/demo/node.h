@@ -11,18 +11,70 @@
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <exception>
+#include <cstddef>
 #include <minisync_api.h>
 #include <protocol.pb.h>
 #include <cinttypes>
 #include "stats.h"
+#include "../replay/trace.h"
 //#include "algorithms/constraints.h"
 
+#ifdef __x86_64__
+#define PRISIZE_T PRIu64
+#else
+#define PRISIZE_T PRId32
+#endif
+
 namespace MiniSync
 {
     typedef struct sockaddr_in SOCKADDR;
 
     // Maximum message length corresponds to the maximum UDP datagram size.
     static const size_t MAX_MSG_LEN = 65507;
+    // Protocol messages are tiny, so datagrams are read into much smaller buffers; larger ones are discarded.
+    static const size_t MSG_BUF_LEN = 512;
+    // Room for the receive timestamp control messages of a datagram (SCM_TIMESTAMPNS and SCM_TIMESTAMPING).
+    static const size_t TIMESTAMP_CONTROL_LEN =
+        CMSG_SPACE(sizeof(struct timespec)) + CMSG_SPACE(3 * sizeof(struct timespec));
+
+    /*
+     * By default, messages are timestamped with steady_clock::now() right before sending and right after receiving
+     * them. With kernel timestamps, they are instead timestamped by the kernel as they leave and arrive
+     * (SO_TIMESTAMPING), which leaves the delays through the network stack and the scheduler out of the bounds. If a
+     * network interface is given and its NIC supports it (this needs CAP_NET_ADMIN), the NIC timestamps them itself.
+     */
+    struct TimestampOptions
+    {
+        bool kernel = false;
+        std::string hw_interface{}; // empty for software timestamps
+    };
+
+    /*
+     * A MiniSyncMsg allocated, along with its payload, on an arena living in a fixed block of memory. reset() replaces
+     * it with a new, empty message in the same memory, so messages can be parsed (which allocates the payload) and
+     * built over and over without touching the heap, as long as they fit in the block.
+     */
+    class ReusableMsg
+    {
+    public:
+        ReusableMsg();
+        ReusableMsg(const ReusableMsg&) = delete;
+        ReusableMsg& operator=(const ReusableMsg&) = delete;
+
+        MiniSync::Protocol::MiniSyncMsg& reset();
+
+    private:
+        static const size_t BLOCK_LEN = 1024;
+
+        alignas(std::max_align_t) char block[BLOCK_LEN]; // has to outlive the arena
+        google::protobuf::Arena arena;
+        MiniSync::Protocol::MiniSyncMsg* msg;
+    };
 
     class Node
     {
@@ -41,27 +93,188 @@ namespace MiniSync
             us_t beacon_reply{0};
         } minimum_delays;
 
-        Node(uint16_t bind_port, MiniSync::Protocol::NodeMode mode);
+        const TimestampOptions timestamps;
+        clockid_t hw_clock;  // clock of the NIC (PTP hardware clock), if it timestamps datagrams, otherwise -1
+        int hw_clock_fd;
+        int tx_timestamp_fd; // socket with transmit timestamps, if any
+        uint32_t tx_count;   // datagrams sent on it, to match them to their timestamps
+        std::atomic<uint64_t> unstamped; // datagrams the kernel was to timestamp, but didn't
+
+        // with reuse_port, more sockets can be bound to the same port to share the incoming datagrams (SO_REUSEPORT)
+        Node(uint16_t bind_port,
+             MiniSync::Protocol::NodeMode mode,
+             const TimestampOptions& timestamps,
+             bool reuse_port = false);
+
+        void estimate_minimum_delays();
+
+        /*
+         * Kernel timestamps: enable_kernel_timestamps() has the kernel (or the NIC, after init_hw_timestamps())
+         * timestamp the datagrams arriving on socket fd, and those sent from it if transmit is set. Then
+         * rx_timestamp() gets the receive timestamp of a datagram from its control messages, and tx_timestamp() waits
+         * for the timestamp of the last datagram sent on the error queue. Both convert the timestamps to the time
+         * since start, and return false if there are none.
+         */
+        void init_hw_timestamps(const std::string& interface);
+        void enable_kernel_timestamps(int fd, bool transmit);
+        bool rx_timestamp(struct msghdr& header, us_t& timestamp) const;
+        bool tx_timestamp(int fd, us_t& timestamp);
+        us_t to_local_time(const struct timespec& ts, clockid_t clock) const;
+
+        /*
+         * Batched I/O: recv_batch() reads as many datagrams as are waiting on socket fd (up to the batch size) into
+         * batch with a single recvmmsg call, without blocking, and returns how many it got. Each one is stamped with
+         * the time the kernel received it, converted to the time since start. send_batch() sends the first count
+         * datagrams of batch with as few sendmmsg calls as possible, and returns how many were sent. The others are
+         * dropped: those the kernel refuses (e.g. unreachable addresses), and all the rest if the send buffer fills up.
+         *
+         * init_batch_io() has to be called for the socket and batches before using them.
+         */
+        struct Datagram
+        {
+            SOCKADDR addr;
+            us_t timestamp;
+            size_t len;
+            uint8_t data[MSG_BUF_LEN];
+            alignas(struct cmsghdr) uint8_t control[TIMESTAMP_CONTROL_LEN];
+        };
 
-        us_t send_message(MiniSync::Protocol::MiniSyncMsg& msg, const sockaddr* dest);
+        struct Batch
+        {
+            std::vector<Datagram> datagrams;
+            std::vector<struct mmsghdr> headers;
+            std::vector<struct iovec> iovecs;
+        };
+
+        void init_batch_io(int fd, uint32_t batch_size, Batch& rx_batch, Batch& tx_batch);
+        uint32_t recv_batch(int fd, Batch& batch);
+        uint32_t send_batch(int fd, Batch& batch, uint32_t count);
+
+        /*
+         * Single messages, on sock_fd, through the rx_buffer and tx_buffer of the node. recv_message() throws a
+         * TimeoutException if the socket times out.
+         */
+        Datagram rx_buffer;
+        Datagram tx_buffer;
+
+        us_t send_message(const MiniSync::Protocol::MiniSyncMsg& msg, const sockaddr* dest);
         us_t recv_message(MiniSync::Protocol::MiniSyncMsg& msg, struct sockaddr* reply_to);
+        // same, on a socket other than sock_fd and through the given buffer
+        us_t send_message(int fd, const MiniSync::Protocol::MiniSyncMsg& msg, const sockaddr* dest, Datagram& buffer);
+        // without blocking: returns false instead of throwing if there is nothing to read on the (non-blocking) socket
+        bool try_recv_message(int fd,
+                              MiniSync::Protocol::MiniSyncMsg& msg,
+                              struct sockaddr* reply_to,
+                              Datagram& buffer,
+                              us_t& timestamp);
     public:
         virtual void run() = 0;
         virtual void shut_down();
         virtual ~Node();
+
+        // datagrams the kernel was to timestamp (with kernel timestamps, and batches on reception) which got a
+        // steady_clock timestamp instead; can be called from any thread
+        uint64_t get_unstamped() const;
     };
 
+    /*
+     * Serves any number of SyncNodes from unconnected sockets. Clients are tracked by address from their handshake on,
+     * and beacons from clients that have not completed one are ignored. All clients share the same time reference,
+     * which starts when the node starts serving.
+     *
+     * With more than one worker, each worker thread gets its own socket bound to the same port with SO_REUSEPORT, and
+     * is pinned to its own core. The kernel picks the socket for each datagram by hashing the client address, so a
+     * client always talks to the same worker, and workers don't share any state but the time reference.
+     */
     class ReferenceNode : public Node
     {
     public:
-        explicit ReferenceNode(uint16_t bind_port);
-        ~ReferenceNode() override = default;
+        // clients that don't send anything for this long are forgotten and have to handshake again
+        static const uint32_t CLIENT_TIMEOUT_SEC = 30;
+        // maximum time the server loop waits for messages before checking if it should keep running
+        static const int POLL_TIMEOUT_MSEC = 100;
+        // datagrams read and answered with one system call each; 1 reads and answers them one by one
+        static const uint32_t DEFAULT_BATCH_SIZE = 64;
+        static const uint32_t MAX_BATCH_SIZE = 1024;
+        static const uint32_t MAX_WORKERS = 1024;
+
+        // totals over all workers
+        struct Counters
+        {
+            uint64_t clients = 0;    // clients with a successful handshake
+            uint64_t received = 0;   // datagrams read
+            uint64_t beacons = 0;    // beacons answered
+            uint64_t handshakes = 0; // handshakes answered, successful or not
+            uint64_t ignored = 0;    // malformed messages, and beacons from clients without a handshake
+            uint64_t dropped = 0;    // replies that could not be sent
+        };
+
+        explicit ReferenceNode(uint16_t bind_port,
+                               uint32_t batch_size = DEFAULT_BATCH_SIZE,
+                               uint32_t workers = 1,
+                               const TimestampOptions& timestamps = TimestampOptions{});
+        ~ReferenceNode() override;
 
         void run() final;
+        // only stops the workers, which notice within POLL_TIMEOUT_MSEC; sockets are closed on destruction
+        void shut_down() override;
+
+        // can be called from any thread
+        Counters get_counters() const;
 
     private:
-        void serve();
-        void wait_for_handshake();
+        struct Client
+        {
+            std::chrono::steady_clock::time_point last_seen;
+            uint64_t beacons;
+        };
+
+        struct Worker
+        {
+            int sock_fd;
+            int epoll_fd;
+            int cpu; // core to pin the worker to, or -1
+            // clients with a successful handshake, keyed by address
+            std::unordered_map<uint64_t, Client> clients;
+            Batch rx_batch;
+            Batch tx_batch;
+            // messages read and answered one by one
+            Datagram rx_buffer;
+            Datagram tx_buffer;
+            std::thread thread;
+            std::exception_ptr error; // what stopped the worker thread, if anything
+
+            // only written by the worker
+            struct
+            {
+                std::atomic<uint64_t> clients{0};
+                std::atomic<uint64_t> received{0};
+                std::atomic<uint64_t> beacons{0};
+                std::atomic<uint64_t> handshakes{0};
+                std::atomic<uint64_t> ignored{0};
+                std::atomic<uint64_t> dropped{0};
+            } counters;
+        };
+
+        const uint32_t batch_size;
+        std::vector<std::unique_ptr<Worker>> workers;
+
+        static uint64_t client_key(const SOCKADDR& addr);
+        static void count(std::atomic<uint64_t>& counter, uint64_t n = 1);
+
+        void serve(Worker& worker);
+        void drain(Worker& worker, ReusableMsg& incoming, ReusableMsg& outgoing);
+        void drain_batched(Worker& worker, ReusableMsg& incoming, ReusableMsg& outgoing);
+        bool handle(Worker& worker,
+                    const MiniSync::Protocol::MiniSyncMsg& incoming,
+                    us_t recv_time,
+                    const SOCKADDR& client_addr,
+                    MiniSync::Protocol::MiniSyncMsg& outgoing);
+        void handshake(Worker& worker,
+                       const MiniSync::Protocol::Handshake& handshake,
+                       const SOCKADDR& client_addr,
+                       MiniSync::Protocol::MiniSyncMsg& outgoing);
+        void forget_idle_clients(Worker& worker);
     };
 
     class SyncNode : public Node
@@ -73,6 +286,7 @@ namespace MiniSync
         const std::string stat_file_path;
         std::shared_ptr<MiniSync::API::Algorithm> algo;
         MiniSync::Stats::SyncStats stats;
+        std::unique_ptr<Trace::Writer> trace; // null unless recording a trace
         void handshake();
         void sync();
         double bw_bytes_per_usecond;
@@ -87,7 +301,9 @@ namespace MiniSync
                  std::shared_ptr<MiniSync::API::Algorithm>&& sync_algo,
                  std::string stat_file_path = "",
                  double bandwidth_mbps = -1.0,
-                 double min_ping_rtt_ms = -1.0);
+                 double min_ping_rtt_ms = -1.0,
+                 const TimestampOptions& timestamps = TimestampOptions{},
+                 const std::string& trace_file_path = "");
         ~SyncNode() override; // = default;
 
         void run() final;
@@ -12,6 +12,8 @@
 #include <fstream>
 #include <loguru.hpp>
 
+const uint32_t MiniSync::Stats::SyncStats::INIT_VEC_SIZE;
+
 void MiniSync::Stats::SyncStats::add_sample(long double offset,
                                             long double offset_error,
                                             long double drift,
@@ -28,12 +28,16 @@ namespace MiniSync
         class SyncStats
         {
         private:
-            static const uint32_t INIT_VEC_SIZE = 100000;
             std::vector<Sample> samples;
 
         public:
-            explicit SyncStats(uint32_t init_capacity = INIT_VEC_SIZE) : samples{init_capacity}
-            {};
+            static const uint32_t INIT_VEC_SIZE = 100000;
+
+            // reserves room for init_capacity samples, so adding them doesn't allocate
+            explicit SyncStats(uint32_t init_capacity = INIT_VEC_SIZE)
+            {
+                this->samples.reserve(init_capacity);
+            };
 
             ~SyncStats() = default;
 
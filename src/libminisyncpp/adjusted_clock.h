@@ -0,0 +1,116 @@
+/*
+* Author: Manuel Olguín Muñoz <manuel@olguin.se>
+*
+* Copyright© 2019 Manuel Olguín Muñoz
+* See LICENSE file included in the root directory of this project for licensing and copyright details.
+*/
+
+#ifndef MINISYNCPP_ADJUSTED_CLOCK_H
+#define MINISYNCPP_ADJUSTED_CLOCK_H
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include "minisync_api.h"
+#include "seqlock.h"
+
+namespace MiniSync
+{
+    /*
+     * Converts readings of a local clock into the time base of the reference node, using the estimates of an
+     * algorithm, at the cost of one clock read and a few integer operations.
+     *
+     * The clock base is explicit: Clock is the clock the local timestamps (To and Tr) were read from, and origin is
+     * the time point they are relative to. E.g. timestamps measured as steady_clock::now() - start need
+     * AdjustedClock<std::chrono::steady_clock>{start}, and timestamps since the UNIX epoch need
+     * AdjustedClock<std::chrono::system_clock>{}. now() and convert() then return times relative to the origin of the
+     * reference timestamps (Tb).
+     *
+     * The estimates relate both clocks as local = drift * reference + offset. Every time they are updated, this is
+     * inverted into fixed-point coefficients, so that converting a local time t (in ns) only takes
+     *
+     *     d = t - offset
+     *     reference = d + ((d * k + 2^(SHIFT - 1)) >> SHIFT), with k = (1 / drift - 1) * 2^SHIFT
+     *
+     * computed with a 128-bit product. Without 128-bit integers (e.g. on 32-bit ARM) the correction d * k is computed
+     * in double instead. Either way, conversions stay within a ns of the exact result for spans of weeks, far below
+     * the estimated errors.
+     *
+     * update() must only be called from one thread at a time, while any number of threads can call now() and
+     * convert() concurrently: the coefficients are published through a SeqLock.
+     */
+    template<typename Clock = std::chrono::steady_clock>
+    class AdjustedClock
+    {
+    public:
+        explicit AdjustedClock(typename Clock::time_point origin = typename Clock::time_point{}) : origin(origin)
+        {};
+
+        /*
+         * Precompute the coefficients for new estimates, e.g. after adding data points to the algorithm:
+         *     clock.update(algo->getEstimates());
+         */
+        void update(const API::Estimates& estimates)
+        {
+            if (!(estimates.drift > 0))
+                throw std::invalid_argument("Drift must be > 0 to convert between clocks.");
+
+            Coefficients c;
+            c.offset = std::llround(estimates.offset.count() * 1000);
+#ifdef __SIZEOF_INT128__
+            const long double k = std::ldexp(1 / estimates.drift - 1, SHIFT);
+            if (std::fabs(k) >= std::ldexp(1.0L, 63))
+                throw std::out_of_range("Drift too far from 1 to convert between clocks.");
+            c.k = std::llround(k);
+#else
+            c.k = static_cast<double>(1 / estimates.drift - 1);
+#endif
+            this->coefficients.publish(c);
+        }
+
+        /*
+         * Current time of the reference clock, relative to its origin. Thread safe.
+         */
+        std::chrono::nanoseconds now() const
+        { return this->convert(Clock::now()); }
+
+        /*
+         * Time of the reference clock corresponding to local time t, relative to its origin. Thread safe.
+         */
+        std::chrono::nanoseconds convert(typename Clock::time_point t) const
+        {
+            const Coefficients c = this->coefficients.read();
+            const int64_t d = std::chrono::duration_cast<std::chrono::nanoseconds>(t - this->origin).count() - c.offset;
+#ifdef __SIZEOF_INT128__
+            __extension__ typedef __int128 wide_t;
+            const wide_t correction = (static_cast<wide_t>(d) * c.k + (static_cast<wide_t>(1) << (SHIFT - 1))) >> SHIFT;
+            return std::chrono::nanoseconds{d + static_cast<int64_t>(correction)};
+#else
+            return std::chrono::nanoseconds{d + std::llround(d * c.k)};
+#endif
+        }
+
+    private:
+        // fractional bits of k: resolves 1 / drift to ~1.4e-17, for drifts above ~0.008
+        static constexpr int SHIFT = 56;
+
+        struct Coefficients
+        {
+            int64_t offset = 0; // ns
+#ifdef __SIZEOF_INT128__
+            int64_t k = 0;
+#else
+            double k = 0;
+#endif
+        };
+
+        const typename Clock::time_point origin;
+        SeqLock<Coefficients> coefficients;
+    };
+
+    template<typename Clock>
+    constexpr int AdjustedClock<Clock>::SHIFT;
+}
+
+#endif //MINISYNCPP_ADJUSTED_CLOCK_H
@@ -0,0 +1,690 @@
+/*
+* Author: Manuel Olguín Muñoz <manuel@olguin.se>
+*
+* Copyright© 2019 Manuel Olguín Muñoz
+* See LICENSE file included in the root directory of this project for licensing and copyright details.
+*/
+
+#ifndef MINISYNCPP_BASIC_SYNC_H
+#define MINISYNCPP_BASIC_SYNC_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#ifdef LIBMINISYNCPP_LOGURU_ENABLE
+
+#include <loguru.hpp>
+
+#endif
+
+#include "lib_config.h"
+#include "checkpoint.h"
+#include "constraints.h"
+#include "estimator.h"
+#include "hull.h"
+#include "minisync_api.h"
+#include "time_types.h"
+
+namespace MiniSync
+{
+    /*
+     * Retention policies for BasicSync, deciding which of the stored points are kept after each update.
+     *
+     * A policy is constructed from its Options, tells BasicSync whether it needs windowed hulls and how many points
+     * each hull is expected to hold (which is reserved up front, so that updates allocate no memory once warmed up),
+     * writes the settings which a checkpoint has to match, and implements cleanup(), which is called after the
+     * constraints are updated and returns true if the constraints need to be searched for again among the remaining
+     * points.
+     */
+    namespace Retention
+    {
+        /*
+         * TinySync only keeps the (at most four) points which define the current constraints.
+         */
+        class TinySync
+        {
+        public:
+            using Options = API::Factory::TinySyncOptions;
+
+            TinySync() = default;
+
+            explicit TinySync(const Options&)
+            {};
+
+            bool windowed() const
+            { return false; }
+
+            // the points of the current constraints, plus the newest one
+            size_t capacity() const
+            { return 3; }
+
+            // identifies the algorithm in checkpoints
+            static uint8_t checkpointId()
+            { return 1; }
+
+            // settings which a checkpoint has to match to be restored, none for TinySync
+            void saveSettings(CheckpointWriter&) const
+            {}
+
+            bool sameSettings(CheckpointReader&) const
+            { return true; }
+
+            template<typename TimeT>
+            bool cleanup(Hull<TimeT>& low_hull, Hull<TimeT>& high_hull,
+                         const ConstraintPoints<TimeT>& low_pts, const ConstraintPoints<TimeT>& high_pts,
+                         PointId) const
+            {
+                low_hull.retain(low_pts.low, high_pts.low);
+                high_hull.retain(low_pts.high, high_pts.high);
+                return false;
+            }
+        };
+
+        /*
+         * MiniSync keeps point Aj only iff M(Ai, Aj) > M(Aj, Ak) for all i < j < k (inverse condition for high
+         * points), i.e. iff it is a vertex of the corresponding convex hull. Points are pruned from the hulls as they
+         * are inserted, so there is only something left to do here if points also need to expire.
+         */
+        class MiniSync
+        {
+        public:
+            using Options = API::Factory::MiniSyncOptions;
+
+            MiniSync() = default;
+
+            explicit MiniSync(const Options& options) : options(options)
+            {
+                if (options.window_samples == 1)
+                    throw std::invalid_argument("MiniSync needs a window of at least 2 samples.");
+                if (options.window_span.count() < 0)
+                    throw std::invalid_argument("MiniSync window span cannot be negative.");
+            };
+
+            bool windowed() const
+            { return this->options.window_samples > 0 || this->options.window_span.count() > 0; }
+
+            // a window in samples bounds the number of stored points, plus the newest one before the cleanup.
+            // otherwise only the hull vertices are stored, and there are rarely more than a few dozen of those.
+            size_t capacity() const
+            { return this->options.window_samples > 0 ? this->options.window_samples + size_t{1} : 64; }
+
+            static uint8_t checkpointId()
+            { return 2; }
+
+            // both window parameters, the span in integer ns
+            void saveSettings(CheckpointWriter& out) const
+            {
+                out.put<uint32_t>(this->options.window_samples);
+                out.put<int64_t>(this->spanNanoseconds());
+            }
+
+            bool sameSettings(CheckpointReader& in) const
+            {
+                const auto samples = in.get<uint32_t>();
+                const auto span = in.get<int64_t>();
+                return samples == this->options.window_samples && span == this->spanNanoseconds();
+            }
+
+            template<typename TimeT>
+            bool cleanup(Hull<TimeT>& low_hull, Hull<TimeT>& high_hull,
+                         const ConstraintPoints<TimeT>& low_pts, const ConstraintPoints<TimeT>& high_pts,
+                         PointId newest_id) const;
+
+        private:
+            Options options;
+
+            int64_t spanNanoseconds() const
+            { return std::chrono::duration_cast<std::chrono::nanoseconds>(this->options.window_span).count(); }
+        };
+    }
+
+    /*
+     * Header-only implementation of TinySync and MiniSync, chosen at compile time through RetentionPolicy, with
+     * timestamps and estimates in the representation given by TimeT (see time_types.h).
+     *
+     * Nothing here is virtual, so applications which embed the algorithm can have the whole update inlined. The
+     * algorithms returned by API::Factory are thin wrappers around this class.
+     */
+    template<typename RetentionPolicy, typename TimeT = Time::LongDoubleMicroseconds>
+    class BasicSync : private Estimator<TimeT>
+    {
+    public:
+        using Options = typename RetentionPolicy::Options;
+        using point_t = typename TimeT::point_t;
+        using real_t = typename TimeT::real_t;
+
+        // timestamps of a single beacon exchange
+        struct Sample
+        {
+            point_t To;
+            point_t Tb;
+            point_t Tr;
+        };
+
+        BasicSync() : BasicSync(Options{})
+        {};
+
+        explicit BasicSync(const Options& options);
+
+        /*
+         * Add a new data point and recalculate offset and drift.
+         * In lazy mode the data point is only queued, and processed once the estimates are needed.
+         */
+        void addDataPoint(point_t To, point_t Tb, point_t Tr);
+
+        /*
+         * Add count data points (in time order) and recalculate offset and drift only once, after all of them.
+         */
+        void addDataPoints(const Sample* samples, size_t count);
+
+        /*
+         * Current estimated relative clock drift, and its (one-sided) error.
+         */
+        real_t getDrift()
+        {
+            this->refresh();
+            return this->currentDrift.value;
+        }
+
+        real_t getDriftError()
+        {
+            this->refresh();
+            return this->currentDrift.error;
+        }
+
+        /*
+         * Current estimated relative clock offset, and its (one-sided) error, in the units of the timestamps.
+         */
+        real_t getOffset()
+        {
+            this->refresh();
+            return this->currentOffset.value;
+        }
+
+        real_t getOffsetError()
+        {
+            this->refresh();
+            return this->currentOffset.error;
+        }
+
+        /*
+         * Current constraint lines, relating the clocks as y = A * x + B: the lower one (A_upper, B_lower) and the
+         * upper one (A_lower, B_upper), see Estimator::updateEstimates(). Only meaningful if hasConstraints().
+         */
+        bool hasConstraints()
+        {
+            this->refresh();
+            return this->has_constraints;
+        }
+
+        const ConstraintLine<TimeT>& getLowConstraint()
+        {
+            this->refresh();
+            return this->current_low;
+        }
+
+        const ConstraintLine<TimeT>& getHighConstraint()
+        {
+            this->refresh();
+            return this->current_high;
+        }
+
+        /*
+         * Current estimates, in µs.
+         */
+        API::Estimates getEstimates()
+        {
+            this->refresh();
+            return this->estimates();
+        }
+
+        /*
+         * See API::Algorithm::toReferenceTime().
+         */
+        void toReferenceTime(const int64_t* local, size_t count, int64_t* reference, int64_t* lower, int64_t* upper)
+        {
+            this->refresh();
+            this->translate(local, count, reference, lower, upper);
+        }
+
+        /*
+         * Appends a checkpoint of the state of the algorithm to out: stored points, current constraints, estimates and
+         * counters. Queued data points are processed first in lazy mode.
+         */
+        void save(std::vector<uint8_t>& out);
+
+        /*
+         * Replaces the state of the algorithm with a checkpoint written by save(), in O(n) time for n stored points.
+         * Throws std::invalid_argument if the checkpoint is corrupt, was written by an incompatible version, or
+         * comes from a different algorithm, time representation or window (both window_samples and window_span).
+         */
+        void load(const uint8_t* data, size_t size);
+
+        /*
+         * In lazy mode, true while there are queued data points which are not reflected in the estimates yet.
+         */
+        bool stale() const
+        { return this->dirty; }
+
+        /*
+         * Brings the estimates up to date in lazy mode. In eager mode they are always up to date.
+         */
+        void refresh();
+
+        /*
+         * Internal counters, see API::Metrics. Doesn't process queued data points in lazy mode.
+         */
+        API::Metrics getMetrics() const;
+
+    private:
+        RetentionPolicy retention;
+
+        // stored points, kept as convex hulls ordered by x:
+        // upper hull of the low points and lower hull of the high points.
+        // the tightest constraint lines are always tangent to these, so points inside them are never stored.
+        Hull<TimeT> low_hull;
+        Hull<TimeT> high_hull;
+
+        // hot path counters, only updated with LIBMINISYNCPP_METRICS_ENABLE
+        struct
+        {
+            uint64_t pairs_evaluated = 0;
+            uint64_t constraint_resets = 0;
+            uint64_t update_ns = 0;
+            uint64_t cleanup_ns = 0;
+        } counters;
+
+#ifdef LIBMINISYNCPP_METRICS_ENABLE
+
+        // adds the time from construction to destruction to a counter
+        class ScopedTimer
+        {
+        public:
+            explicit ScopedTimer(uint64_t& total) : total(total), start(std::chrono::steady_clock::now())
+            {};
+
+            ~ScopedTimer()
+            {
+                this->total += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - this->start).count();
+            }
+
+        private:
+            uint64_t& total;
+            std::chrono::steady_clock::time_point start;
+        };
+
+#endif
+
+        // in lazy mode, data points are queued and only processed once the estimates are read
+        static constexpr size_t MAX_PENDING = 1024;
+
+        // "MSCP", in native byte order
+        static constexpr uint32_t CHECKPOINT_MAGIC = 0x5043534Du;
+        static constexpr uint16_t CHECKPOINT_VERSION = 2;
+        bool lazy;
+        bool dirty; // estimates need to be recalculated
+        std::vector<Sample> pending;
+
+        void processDataPoint(point_t To, point_t Tb, point_t Tr);
+        void processPending();
+        void cleanup();
+
+        void __recalculateConstraints(PointId id, point_t To, point_t Tb, point_t Tr);
+
+        /*
+         * Discards the current constraint lines and searches for the tightest ones among all stored points.
+         */
+        void resetConstraints();
+    };
+}
+
+template<typename TimeT>
+bool MiniSync::Retention::MiniSync::cleanup(Hull<TimeT>& low_hull, Hull<TimeT>& high_hull,
+                                            const ConstraintPoints<TimeT>& low_pts,
+                                            const ConstraintPoints<TimeT>& high_pts,
+                                            PointId newest_id) const
+{
+    using point_t = typename TimeT::point_t;
+
+    const uint32_t window_samples = this->options.window_samples;
+    const point_t window_span = TimeT::fromMicroseconds(this->options.window_span);
+    if (window_samples == 0 && window_span == 0) return false;
+
+    // both hulls end with the newest points
+    const point_t newest_x = std::max(low_hull.getX(low_hull.size() - 1), high_hull.getX(high_hull.size() - 1));
+
+    // ids wrap around, but the difference to the newest one is always the age in samples
+    auto expired = [&](PointId id, point_t x)
+    {
+        return (window_samples > 0 && static_cast<PointId>(newest_id - id) >= window_samples) ||
+               (window_span > 0 && newest_x - x > window_span);
+    };
+
+    // the two newest points on each side are never evicted, as they are needed to get constraints at all
+    while (low_hull.pointCount() > 2 && expired(low_hull.getOldestId(), low_hull.getOldestX()))
+        low_hull.popOldest();
+    while (high_hull.pointCount() > 2 && expired(high_hull.getOldestId(), high_hull.getOldestX()))
+        high_hull.popOldest();
+
+    // current constraints are still the tightest ones if none of their points was evicted
+    const point_t low_oldest = low_hull.getOldestX();
+    const point_t high_oldest = high_hull.getOldestX();
+    return low_pts.low_x < low_oldest || low_pts.high_x < high_oldest ||
+           high_pts.low_x < low_oldest || high_pts.high_x < high_oldest;
+}
+
+template<typename RetentionPolicy, typename TimeT>
+constexpr size_t MiniSync::BasicSync<RetentionPolicy, TimeT>::MAX_PENDING;
+
+template<typename RetentionPolicy, typename TimeT>
+constexpr uint32_t MiniSync::BasicSync<RetentionPolicy, TimeT>::CHECKPOINT_MAGIC;
+
+template<typename RetentionPolicy, typename TimeT>
+constexpr uint16_t MiniSync::BasicSync<RetentionPolicy, TimeT>::CHECKPOINT_VERSION;
+
+template<typename RetentionPolicy, typename TimeT>
+MiniSync::BasicSync<RetentionPolicy, TimeT>::BasicSync(const Options& options) :
+    retention(options),
+    low_hull(true, retention.windowed()),
+    high_hull(false, retention.windowed()),
+    lazy(options.lazy),
+    dirty(false)
+{
+    this->low_hull.reserve(this->retention.capacity());
+    this->high_hull.reserve(this->retention.capacity());
+    if (this->lazy) this->pending.reserve(MAX_PENDING);
+}
+
+template<typename RetentionPolicy, typename TimeT>
+void MiniSync::BasicSync<RetentionPolicy, TimeT>::addDataPoint(point_t To, point_t Tb, point_t Tr)
+{
+    if (this->lazy)
+    {
+        this->pending.push_back({To, Tb, Tr});
+        this->dirty = true;
+        // don't let the queue grow without bounds if nobody reads the estimates
+        if (this->pending.size() >= MAX_PENDING) this->processPending();
+        return;
+    }
+
+#ifdef LIBMINISYNCPP_METRICS_ENABLE
+    ScopedTimer timer{this->counters.update_ns};
+#endif
+    this->processDataPoint(To, Tb, Tr);
+    if (this->processed_timestamps > 1) this->updateEstimates();
+}
+
+/*
+ * Adds a data point to the internal storage and updates the constraints, without touching the estimates.
+ */
+template<typename RetentionPolicy, typename TimeT>
+void MiniSync::BasicSync<RetentionPolicy, TimeT>::processDataPoint(point_t To, point_t Tb, point_t Tr)
+{
+    // points are identified by the index of the sample they come from
+    PointId id = this->processed_timestamps;
+    this->low_hull.insert(Tb, To, id);
+    this->high_hull.insert(Tb, Tr, id);
+    ++this->processed_timestamps;
+
+    if (this->processed_timestamps > 1)
+    {
+        // n_th sample, n >= 1
+        // pass it on to the specific algorithm
+        this->__recalculateConstraints(id, To, Tb, Tr);
+    }
+}
+
+/*
+ * Processes the data points queued in lazy mode, in the same order and in the same way as eager mode would have.
+ */
+template<typename RetentionPolicy, typename TimeT>
+void MiniSync::BasicSync<RetentionPolicy, TimeT>::processPending()
+{
+#ifdef LIBMINISYNCPP_METRICS_ENABLE
+    ScopedTimer timer{this->counters.update_ns};
+#endif
+    for (const auto& p: this->pending)
+        this->processDataPoint(p.To, p.Tb, p.Tr);
+    this->pending.clear();
+}
+
+template<typename RetentionPolicy, typename TimeT>
+void MiniSync::BasicSync<RetentionPolicy, TimeT>::refresh()
+{
+    if (!this->dirty) return;
+
+    this->processPending();
+#ifdef LIBMINISYNCPP_METRICS_ENABLE
+    ScopedTimer timer{this->counters.update_ns};
+#endif
+    if (this->processed_timestamps > 1) this->updateEstimates();
+    this->dirty = false;
+}
+
+template<typename RetentionPolicy, typename TimeT>
+MiniSync::API::Metrics MiniSync::BasicSync<RetentionPolicy, TimeT>::getMetrics() const
+{
+    API::Metrics metrics;
+#ifdef LIBMINISYNCPP_METRICS_ENABLE
+    metrics.instrumented = true;
+#endif
+    metrics.samples = this->processed_timestamps + this->pending.size();
+    metrics.pending = this->pending.size();
+    // windowed hulls also store the points in the window which are currently not vertices
+    metrics.low_points = this->retention.windowed() ? this->low_hull.pointCount() : this->low_hull.size();
+    metrics.high_points = this->retention.windowed() ? this->high_hull.pointCount() : this->high_hull.size();
+    metrics.constraints = this->has_constraints ? 2 : 0;
+    metrics.memory_bytes = this->low_hull.memoryBytes() + this->high_hull.memoryBytes() +
+                           this->pending.capacity() * sizeof(Sample);
+    metrics.pairs_evaluated = this->counters.pairs_evaluated;
+    metrics.constraint_resets = this->counters.constraint_resets;
+    metrics.update_ns = this->counters.update_ns;
+    metrics.cleanup_ns = this->counters.cleanup_ns;
+    return metrics;
+}
+
+/*
+ * Removes un-used data points from the internal storage, according to the retention policy.
+ */
+template<typename RetentionPolicy, typename TimeT>
+void MiniSync::BasicSync<RetentionPolicy, TimeT>::cleanup()
+{
+#ifdef LIBMINISYNCPP_METRICS_ENABLE
+    ScopedTimer timer{this->counters.cleanup_ns};
+#endif
+    if (this->retention.cleanup(this->low_hull, this->high_hull, this->low_constraint_pts, this->high_constraint_pts,
+                                static_cast<PointId>(this->processed_timestamps - 1)))
+        this->resetConstraints();
+}
+
+/*
+ * Adds a batch of data points to the algorithm and recalculates the drift and offset estimates once.
+ *
+ * Instead of updating the constraints after each point, the tightest ones are searched for among all the stored
+ * points after inserting the whole batch. For MiniSync this gives the same estimates as adding the points one by one.
+ * TinySync on the other hand gets to choose among all points in the batch instead of only the ones it would have kept
+ * along the way, so its bounds are at least as tight.
+ */
+template<typename RetentionPolicy, typename TimeT>
+void MiniSync::BasicSync<RetentionPolicy, TimeT>::addDataPoints(const Sample* samples, size_t count)
+{
+    if (count == 0) return;
+
+    // keep the order of the data points
+    this->processPending();
+#ifdef LIBMINISYNCPP_METRICS_ENABLE
+    ScopedTimer timer{this->counters.update_ns};
+#endif
+    for (size_t i = 0; i < count; ++i)
+    {
+        PointId id = this->processed_timestamps;
+        this->low_hull.insert(samples[i].Tb, samples[i].To, id);
+        this->high_hull.insert(samples[i].Tb, samples[i].Tr, id);
+        ++this->processed_timestamps;
+    }
+
+    if (this->processed_timestamps > 1)
+    {
+        this->resetConstraints();
+        this->cleanup();
+        if (this->lazy)
+            this->dirty = true;
+        else
+            this->updateEstimates();
+    }
+}
+
+/*
+ * Update the constraint lines with the newest sample, see Estimator::tightenConstraints(), and drop the points which
+ * are no longer needed.
+ */
+template<typename RetentionPolicy, typename TimeT>
+void MiniSync::BasicSync<RetentionPolicy, TimeT>::__recalculateConstraints(PointId id,
+                                                                          point_t To, point_t Tb, point_t Tr)
+{
+    const uint32_t evaluated = this->tightenConstraints(this->low_hull, this->high_hull, id, To, Tb, Tr);
+#ifdef LIBMINISYNCPP_METRICS_ENABLE
+    this->counters.pairs_evaluated += evaluated;
+#else
+    (void) evaluated;
+#endif
+    this->cleanup();
+}
+
+/*
+ * Discards the current constraint lines and searches for the tightest ones among all stored points, in O(n log n)
+ * time for n stored points.
+ *
+ * The lower line with minimum slope is tangent to both hulls, so it is enough to check the tangents from every high
+ * point to the low points to its left. The same goes for the upper line with maximum slope, checking the tangents from
+ * every low point to the high points to its left.
+ */
+template<typename RetentionPolicy, typename TimeT>
+void MiniSync::BasicSync<RetentionPolicy, TimeT>::resetConstraints()
+{
+#ifdef LIBMINISYNCPP_METRICS_ENABLE
+    // every candidate line is compared against the best one so far
+    ++this->counters.constraint_resets;
+    this->counters.pairs_evaluated += this->low_hull.size() + this->high_hull.size();
+#endif
+    bool found_low = false;
+    bool found_high = false;
+
+    for (size_t j = 0; j < this->high_hull.size(); ++j)
+    {
+        size_t i = this->low_hull.findTangent(this->high_hull.getX(j), this->high_hull.getY(j));
+        if (i == this->low_hull.size()) continue;
+
+        ConstraintLine<TimeT> line{LowPoint<TimeT>{this->low_hull.getX(i), this->low_hull.getY(i)},
+                                   HighPoint<TimeT>{this->high_hull.getX(j), this->high_hull.getY(j)}};
+        if (!found_low || line.getA() < this->current_low.getA() ||
+            (line.getA() == this->current_low.getA() && line.getB() > this->current_low.getB()))
+        {
+            this->current_low = line;
+            this->low_constraint_pts.low = this->low_hull.getId(i);
+            this->low_constraint_pts.high = this->high_hull.getId(j);
+            this->low_constraint_pts.low_x = this->low_hull.getX(i);
+            this->low_constraint_pts.high_x = this->high_hull.getX(j);
+            found_low = true;
+        }
+    }
+
+    for (size_t i = 0; i < this->low_hull.size(); ++i)
+    {
+        size_t j = this->high_hull.findTangent(this->low_hull.getX(i), this->low_hull.getY(i));
+        if (j == this->high_hull.size()) continue;
+
+        ConstraintLine<TimeT> line{LowPoint<TimeT>{this->low_hull.getX(i), this->low_hull.getY(i)},
+                                   HighPoint<TimeT>{this->high_hull.getX(j), this->high_hull.getY(j)}};
+        if (!found_high || line.getA() > this->current_high.getA() ||
+            (line.getA() == this->current_high.getA() && line.getB() < this->current_high.getB()))
+        {
+            this->current_high = line;
+            this->high_constraint_pts.low = this->low_hull.getId(i);
+            this->high_constraint_pts.high = this->high_hull.getId(j);
+            this->high_constraint_pts.low_x = this->low_hull.getX(i);
+            this->high_constraint_pts.high_x = this->high_hull.getX(j);
+            found_high = true;
+        }
+    }
+
+    this->has_constraints = found_low && found_high;
+    if (this->has_constraints)
+        this->diff_factor = (this->current_low.getA() - this->current_high.getA()) *
+                            (this->current_high.getB() - this->current_low.getB());
+    else
+        this->diff_factor = std::numeric_limits<real_t>::max();
+}
+
+/*
+ * Checkpoint layout (version 2), all in native byte order:
+ *
+ *  - header: magic, version, algorithm and time representation IDs, stored sizes of point_t and real_t
+ *  - settings of the retention policy: for MiniSync the window in samples and its span in ns
+ *  - number of processed samples, whether there are constraints
+ *  - both constraint lines (A, B) with the IDs and x coordinates of their points, and diff_factor
+ *  - drift and offset estimates with their errors
+ *  - low hull, then high hull (see Hull::save())
+ */
+template<typename RetentionPolicy, typename TimeT>
+void MiniSync::BasicSync<RetentionPolicy, TimeT>::save(std::vector<uint8_t>& out)
+{
+    this->refresh();
+
+    CheckpointWriter writer{out};
+    writer.put(CHECKPOINT_MAGIC);
+    writer.put(CHECKPOINT_VERSION);
+    writer.put(RetentionPolicy::checkpointId());
+    writer.put(TimeT::checkpointId());
+    writer.put<uint8_t>(checkpointSize<point_t>());
+    writer.put<uint8_t>(checkpointSize<real_t>());
+    this->retention.saveSettings(writer);
+
+    this->saveState(writer);
+    this->low_hull.save(writer);
+    this->high_hull.save(writer);
+}
+
+template<typename RetentionPolicy, typename TimeT>
+void MiniSync::BasicSync<RetentionPolicy, TimeT>::load(const uint8_t* data, size_t size)
+{
+    CheckpointReader reader{data, size};
+    if (reader.get<uint32_t>() != CHECKPOINT_MAGIC)
+        throw std::invalid_argument("Not a checkpoint, or taken on a platform with different byte order.");
+    if (reader.get<uint16_t>() != CHECKPOINT_VERSION)
+        throw std::invalid_argument("Unsupported checkpoint version.");
+    if (reader.get<uint8_t>() != RetentionPolicy::checkpointId())
+        throw std::invalid_argument("Checkpoint was taken from a different algorithm.");
+    if (reader.get<uint8_t>() != TimeT::checkpointId())
+        throw std::invalid_argument("Checkpoint was taken with a different time representation.");
+    if (reader.get<uint8_t>() != checkpointSize<point_t>() || reader.get<uint8_t>() != checkpointSize<real_t>())
+        throw std::invalid_argument("Checkpoint was taken on a platform with different type sizes.");
+    if (!this->retention.sameSettings(reader))
+        throw std::invalid_argument("Checkpoint was taken with a different window.");
+
+    // read everything before touching the current state
+    Estimator<TimeT> state;
+    state.loadState(reader);
+    Hull<TimeT> low(true, this->retention.windowed());
+    Hull<TimeT> high(false, this->retention.windowed());
+    low.load(reader);
+    high.load(reader);
+    if (reader.left() != 0)
+        throw std::invalid_argument("Corrupt checkpoint: trailing data.");
+
+    static_cast<Estimator<TimeT>&>(*this) = state;
+    this->low_hull = std::move(low);
+    this->high_hull = std::move(high);
+    this->low_hull.reserve(this->retention.capacity());
+    this->high_hull.reserve(this->retention.capacity());
+    this->pending.clear();
+    this->dirty = false;
+}
+
+#endif //MINISYNCPP_BASIC_SYNC_H
@@ -0,0 +1,104 @@
+/*
+* Author: Manuel Olguín Muñoz <manuel@olguin.se>
+*
+* Copyright© 2019 Manuel Olguín Muñoz
+* See LICENSE file included in the root directory of this project for licensing and copyright details.
+*/
+
+#ifndef MINISYNCPP_CHECKPOINT_H
+#define MINISYNCPP_CHECKPOINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace MiniSync
+{
+    /*
+     * Minimal binary encoding for checkpoints of the algorithm state.
+     *
+     * Values are stored with their in-memory representation, so a checkpoint can only be restored on a platform with
+     * the same endianness and sizes of the types involved. The header written by the algorithms records these, so
+     * that mismatches are rejected instead of misread. The padding of x87 extended precision long doubles (which
+     * only use the first 10 of their 12 or 16 bytes) is left out, which keeps checkpoints compact and deterministic.
+     */
+    template<typename T>
+    constexpr size_t checkpointSize()
+    {
+        return std::is_same<T, long double>::value && std::numeric_limits<long double>::digits == 64 &&
+               std::numeric_limits<long double>::max_exponent == 16384 ? 10 : sizeof(T);
+    }
+
+    /*
+     * Appends values to a checkpoint.
+     */
+    class CheckpointWriter
+    {
+    public:
+        explicit CheckpointWriter(std::vector<uint8_t>& out) : out(out)
+        {};
+
+        template<typename T>
+        void put(const T& value)
+        { this->putArray(&value, 1); }
+
+        template<typename T>
+        void putArray(const T* values, size_t count)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be stored.");
+            const size_t size = this->out.size();
+            this->out.resize(size + count * checkpointSize<T>());
+            for (size_t i = 0; i < count; ++i)
+                std::memcpy(this->out.data() + size + i * checkpointSize<T>(), values + i, checkpointSize<T>());
+        }
+
+    private:
+        std::vector<uint8_t>& out;
+    };
+
+    /*
+     * Reads back what CheckpointWriter wrote. Throws std::invalid_argument when running out of data.
+     */
+    class CheckpointReader
+    {
+    public:
+        CheckpointReader(const uint8_t* data, size_t size) : data(data), remaining(size)
+        {};
+
+        template<typename T>
+        T get()
+        {
+            T value;
+            this->getArray(&value, 1);
+            return value;
+        }
+
+        template<typename T>
+        void getArray(T* values, size_t count)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be read.");
+            if (count > this->remaining / checkpointSize<T>())
+                throw std::invalid_argument("Truncated checkpoint.");
+            for (size_t i = 0; i < count; ++i)
+            {
+                std::memset(values + i, 0, sizeof(T));
+                std::memcpy(values + i, this->data + i * checkpointSize<T>(), checkpointSize<T>());
+            }
+            this->data += count * checkpointSize<T>();
+            this->remaining -= count * checkpointSize<T>();
+        }
+
+        size_t left() const
+        { return this->remaining; }
+
+    private:
+        const uint8_t* data;
+        size_t remaining;
+    };
+}
+
+#endif //MINISYNCPP_CHECKPOINT_H
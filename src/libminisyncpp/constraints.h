@@ -12,29 +12,41 @@
 # include <exception>
 # include <map>
 # include <set>
+# include <stdexcept>
+
+#ifdef LIBMINISYNCPP_LOGURU_ENABLE
+
+#include <loguru.hpp>
+
+#endif
+
+# include "hull.h"
 # include "minisync_api.h"
+# include "time_types.h"
 
 namespace MiniSync
 {
-
+    template<typename TimeT>
     class Point
     {
+    public:
+        using point_t = typename TimeT::point_t;
     private:
-        us_t x;
-        us_t y;
+        point_t x;
+        point_t y;
     public:
         Point() : x(0), y(0)
         {};
 
-        Point(us_t x, us_t y) : x(x), y(y)
+        Point(point_t x, point_t y) : x(x), y(y)
         {};
 
-        const us_t& getX() const
+        const point_t& getX() const
         {
             return this->x;
         }
 
-        const us_t& getY() const
+        const point_t& getY() const
         {
             return this->y;
         }
@@ -44,25 +56,28 @@ namespace MiniSync
         bool operator==(const Point& o) const;
     };
 
-    class LowPoint : public Point
+    template<typename TimeT>
+    class LowPoint : public Point<TimeT>
     {
     public:
-        LowPoint() : Point()
+        using point_t = typename TimeT::point_t;
+
+        LowPoint() : Point<TimeT>()
         {}
 
-        LowPoint(us_t x, us_t y) : Point(x, y)
+        LowPoint(point_t x, point_t y) : Point<TimeT>(x, y)
         {}
 
         LowPoint(const LowPoint& o) = default;
 
         bool operator==(const LowPoint& o) const
         {
-            return Point::operator==(o);
+            return Point<TimeT>::operator==(o);
         };
 
         bool operator!=(const LowPoint& o) const
         {
-            return !Point::operator==(o);
+            return !Point<TimeT>::operator==(o);
         }
 
         bool operator<(const LowPoint& o) const
@@ -76,25 +91,28 @@ namespace MiniSync
         }
     };
 
-    class HighPoint : public Point
+    template<typename TimeT>
+    class HighPoint : public Point<TimeT>
     {
     public:
-        HighPoint() : Point()
+        using point_t = typename TimeT::point_t;
+
+        HighPoint() : Point<TimeT>()
         {}
 
-        HighPoint(us_t x, us_t y) : Point(x, y)
+        HighPoint(point_t x, point_t y) : Point<TimeT>(x, y)
         {}
 
         HighPoint(const HighPoint& o) = default;
 
         bool operator==(const HighPoint& o) const
         {
-            return Point::operator==(o);
+            return Point<TimeT>::operator==(o);
         };
 
         bool operator!=(const HighPoint& o) const
         {
-            return !Point::operator==(o);
+            return !Point<TimeT>::operator==(o);
         }
 
         bool operator<(const HighPoint& o) const
@@ -108,25 +126,29 @@ namespace MiniSync
         }
     };
 
+    template<typename TimeT>
     class ConstraintLine
     {
     public:
+        using real_t = typename TimeT::real_t;
 
         ConstraintLine() : A(0), B(0)
         {};
-        ConstraintLine(const LowPoint& p1, const HighPoint& p2);
+        ConstraintLine(real_t A, real_t B) : A(A), B(B)
+        {};
+        ConstraintLine(const LowPoint<TimeT>& p1, const HighPoint<TimeT>& p2);
 
-        ConstraintLine(const HighPoint& p1, const LowPoint& p2) : ConstraintLine(p2, p1)
+        ConstraintLine(const HighPoint<TimeT>& p1, const LowPoint<TimeT>& p2) : ConstraintLine(p2, p1)
         {};
 
-        ConstraintLine(const ConstraintLine& o) :
-        A(o.getA()), B(o.getB())
-        {}
+        ConstraintLine(const ConstraintLine& o) = default;
+        ConstraintLine& operator=(const ConstraintLine& o) = default;
 
-        long double getA() const
+        real_t getA() const
         { return this->A; }
 
-        us_t getB() const
+        // in the units of the timestamps
+        real_t getB() const
         { return this->B; }
 
         bool operator==(const ConstraintLine& o) const;
@@ -134,18 +156,50 @@ namespace MiniSync
         std::string toString() const;
 
     private:
-        long double A;
-        us_t B;
+        real_t A;
+        real_t B;
 
     };
-}
 
-namespace std
-{
-    template<>
-    struct hash<MiniSync::Point>
+    // points which define a constraint line
+    template<typename TimeT>
+    struct ConstraintPoints
     {
-        size_t operator()(const MiniSync::Point& point) const;
+        PointId low = 0;
+        PointId high = 0;
+        typename TimeT::point_t low_x = 0;
+        typename TimeT::point_t high_x = 0;
     };
 }
+
+template<typename TimeT>
+bool MiniSync::Point<TimeT>::operator==(const Point& o) const
+{
+    return this->x == o.x && this->y == o.y;
+}
+
+template<typename TimeT>
+MiniSync::ConstraintLine<TimeT>::ConstraintLine(const LowPoint<TimeT>& p1, const HighPoint<TimeT>& p2) : B(0)
+{
+#ifdef LIBMINISYNCPP_LOGURU_ENABLE
+    CHECK_NE_F(p1.getX(), p2.getX(), "Points in a constraint line cannot have the same REF timestamp!");
+#else
+    if (p1.getX() == p2.getX())
+        throw std::runtime_error("Points in a constraint line cannot have the same REF timestamp!");
+#endif
+
+    // differences of timestamps are exact, so they are taken before converting
+    this->A = static_cast<real_t>(p2.getY() - p1.getY()) / static_cast<real_t>(p2.getX() - p1.getX());
+
+    // slope can't be negative
+    // CHECK_GT_F(this->A, 0, "Slope can't be negative!"); // it actually can, at least for the constrain lines
+    this->B = static_cast<real_t>(p1.getY()) - (this->A * static_cast<real_t>(p1.getX()));
+}
+
+template<typename TimeT>
+bool MiniSync::ConstraintLine<TimeT>::operator==(const ConstraintLine& o) const
+{
+    return this->A == o.getA() && this->B == o.getB();
+}
+
 #endif //MINISYNCPP_CONSTRAINTS_H
@@ -0,0 +1,329 @@
+/*
+* Author: Manuel Olguín Muñoz <manuel@olguin.se>
+*
+* Copyright© 2019 Manuel Olguín Muñoz
+* See LICENSE file included in the root directory of this project for licensing and copyright details.
+*/
+
+#ifndef MINISYNCPP_ESTIMATOR_H
+#define MINISYNCPP_ESTIMATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+#ifdef LIBMINISYNCPP_LOGURU_ENABLE
+
+#include <loguru.hpp>
+
+#endif
+
+#include "checkpoint.h"
+#include "constraints.h"
+#include "hull.h"
+#include "minisync_api.h"
+#include "time_types.h"
+#include "translate.h"
+
+namespace MiniSync
+{
+    /*
+     * The current pair of constraint lines and the estimates derived from them, with the steps of the update which
+     * don't depend on how the points are stored. BasicSync and FixedMiniSync both derive from it, and only differ in
+     * their hulls and in which points they keep.
+     *
+     * The hulls are passed in as templates, and only need size(), getX(i), getY(i), getId(i) and findTangent(x, y),
+     * as provided by both Hull and FixedHull. The algorithms inherit privately, so nothing here is part of their
+     * interface; it's public so that they can read checkpoints into a separate instance first.
+     */
+    template<typename TimeT>
+    class Estimator
+    {
+    public:
+        using point_t = typename TimeT::point_t;
+        using real_t = typename TimeT::real_t;
+
+        ConstraintLine<TimeT> current_high;
+        ConstraintLine<TimeT> current_low;
+        ConstraintPoints<TimeT> high_constraint_pts;
+        ConstraintPoints<TimeT> low_constraint_pts;
+        bool has_constraints = false; // false until the first pair of constraint lines is found
+
+        struct
+        {
+            real_t value = 1.0;
+            real_t error = 0.0;
+        } currentDrift; // relative drift of the clock
+
+        struct
+        {
+            real_t value = 0.0;
+            real_t error = 0.0;
+        } currentOffset; // current offset, in the units of the timestamps
+
+        real_t diff_factor = std::numeric_limits<real_t>::max(); // difference between current lines
+        uint64_t processed_timestamps = 0;
+
+        /*
+         * Updates the constraint lines with the newest sample, which has already been inserted into the hulls.
+         * Returns the number of pairs of lines evaluated.
+         */
+        template<typename LowHull, typename HighHull>
+        uint32_t tightenConstraints(const LowHull& low_hull, const HighHull& high_hull,
+                                    PointId id, point_t To, point_t Tb, point_t Tr);
+
+        /*
+         * Derives drift and offset from the current constraint lines.
+         */
+        void updateEstimates();
+
+        /*
+         * The current estimates, in µs.
+         */
+        API::Estimates estimates() const;
+
+        /*
+         * See API::Algorithm::toReferenceTime(). Throws if there are no constraints yet.
+         */
+        void translate(const int64_t* local, size_t count, int64_t* reference, int64_t* lower, int64_t* upper) const;
+
+        /*
+         * Writes the counters, constraints and estimates to a checkpoint, and reads them back.
+         */
+        void saveState(CheckpointWriter& out) const;
+        void loadState(CheckpointReader& in);
+    };
+}
+
+/*
+ * Update the constraint lines with the newest sample.
+ */
+template<typename TimeT>
+template<typename LowHull, typename HighHull>
+uint32_t MiniSync::Estimator<TimeT>::tightenConstraints(const LowHull& low_hull, const HighHull& high_hull,
+                                                        PointId id, point_t To, point_t Tb, point_t Tr)
+{
+    // assume timestamps come in time order
+    //
+    // find the tightest bound
+    // only need to compare the current lines with the lines through the newest points:
+    // l_i -> n_h (lower lines, a_upper * x + b_lower)
+    // h_i -> n_l (upper lines, a_lower * x + b_upper)
+    //
+    // out of all lower lines through n_h, the one with minimum slope also has the maximum intercept, and it always
+    // touches the upper hull of the low points. Equivalently, the upper line through n_l with maximum slope (and
+    // minimum intercept) touches the lower hull of the high points. Both are found with a binary search on the hulls.
+    //
+    // find minimum (a_upper - a_lower)(b_upper - b_lower)
+
+    ConstraintLine<TimeT> new_low;
+    ConstraintLine<TimeT> new_high;
+    ConstraintPoints<TimeT> new_low_pts;
+    ConstraintPoints<TimeT> new_high_pts;
+    bool found_low = false;
+    bool found_high = false;
+
+    size_t idx = low_hull.findTangent(Tb, Tr);
+    if (idx < low_hull.size())
+    {
+        new_low = ConstraintLine<TimeT>{LowPoint<TimeT>{low_hull.getX(idx), low_hull.getY(idx)},
+                                        HighPoint<TimeT>{Tb, Tr}};
+        new_low_pts.low = low_hull.getId(idx);
+        new_low_pts.high = id;
+        new_low_pts.low_x = low_hull.getX(idx);
+        new_low_pts.high_x = Tb;
+        found_low = true;
+    }
+
+    idx = high_hull.findTangent(Tb, To);
+    if (idx < high_hull.size())
+    {
+        new_high = ConstraintLine<TimeT>{LowPoint<TimeT>{Tb, To},
+                                         HighPoint<TimeT>{high_hull.getX(idx), high_hull.getY(idx)}};
+        new_high_pts.low = id;
+        new_high_pts.high = high_hull.getId(idx);
+        new_high_pts.low_x = Tb;
+        new_high_pts.high_x = high_hull.getX(idx);
+        found_high = true;
+    }
+
+    // only compare combinations involving at least one new line; the current pair already set diff_factor
+    const ConstraintLine<TimeT>* low_lines[] = {this->has_constraints ? &this->current_low : nullptr,
+                                                found_low ? &new_low : nullptr};
+    const ConstraintLine<TimeT>* high_lines[] = {this->has_constraints ? &this->current_high : nullptr,
+                                                 found_high ? &new_high : nullptr};
+
+    real_t tmp_diff;
+    uint32_t evaluated = 0;
+    size_t best_low = 0;
+    size_t best_high = 0;
+    for (size_t i = 0; i < 2; ++i)
+    {
+        for (size_t j = 0; j < 2; ++j)
+        {
+            if (i == 0 && j == 0) continue;
+            const ConstraintLine<TimeT>* tmp_low = low_lines[i];
+            const ConstraintLine<TimeT>* tmp_high = high_lines[j];
+            if (tmp_low == nullptr || tmp_high == nullptr) continue;
+            ++evaluated;
+
+            tmp_diff = (tmp_low->getA() - tmp_high->getA()) * (tmp_high->getB() - tmp_low->getB());
+            if (tmp_diff < this->diff_factor)
+            {
+                this->diff_factor = tmp_diff;
+                best_low = i;
+                best_high = j;
+            }
+        }
+    }
+
+    if (best_low != 0)
+    {
+        this->current_low = new_low;
+        this->low_constraint_pts = new_low_pts;
+    }
+    if (best_high != 0)
+    {
+        this->current_high = new_high;
+        this->high_constraint_pts = new_high_pts;
+    }
+    this->has_constraints = this->has_constraints || best_low != 0 || best_high != 0;
+    return evaluated;
+}
+
+/*
+ * Update estimate based on the constraints we have stored.
+ *
+ * Considering
+ *
+ * constraint1 = {tol, tbl, trl}
+ * constraint2 = {tor, tbr, trr}
+ *
+ * We have four points to build two linear equations:
+ * {tbl, tol} -> {tbr, trr}: (A_upper, B_lower)
+ * {tbl, trl} -> {tbr, tor}: (A_lower, B_upper)
+ *
+ * Where
+ * A_upper = (trr - tol)/(tbr - tbl)
+ * A_lower = (tor - trl)/(tbr - tbl)
+ * B_upper = trl - A_lower * tbl
+ * B_lower = tol - A_upper * tbl
+ *
+ * Using these bounds, we can estimate the Drift and Offset as
+ *
+ * Drift = (A_upper + A_lower)/2
+ * Offset = (B_upper + B_lower)/2
+ * Drift_Error = (A_upper - A_lower)/2
+ * Offset_Error = (B_upper - B_lower)/2
+ */
+template<typename TimeT>
+void MiniSync::Estimator<TimeT>::updateEstimates()
+{
+#ifdef LIBMINISYNCPP_LOGURU_ENABLE
+    CHECK_F(this->has_constraints, "No constraint lines available!");
+#else
+    if (!this->has_constraints)
+        throw std::runtime_error("No constraint lines available!");
+#endif
+
+    this->currentDrift.value = (this->current_low.getA() + this->current_high.getA()) / 2;
+    this->currentOffset.value = (this->current_low.getB() + this->current_high.getB()) / 2;
+    this->currentDrift.error = (this->current_low.getA() - this->current_high.getA()) / 2;
+    this->currentOffset.error = (this->current_high.getB() - this->current_low.getB()) / 2;
+
+#ifdef LIBMINISYNCPP_LOGURU_ENABLE
+    CHECK_GE_F(this->currentDrift.value,
+               0,
+               "Drift must be >=0 for monotonically increasing clocks... (actual value: %Lf)",
+               static_cast<long double>(this->currentDrift.value));
+#else
+    if (this->currentDrift.value < 0)
+        throw std::runtime_error("Drift must be >=0 for monotonically increasing clocks...");
+#endif
+}
+
+template<typename TimeT>
+MiniSync::API::Estimates MiniSync::Estimator<TimeT>::estimates() const
+{
+    API::Estimates estimates;
+    estimates.drift = this->currentDrift.value;
+    estimates.drift_error = this->currentDrift.error;
+    estimates.offset = TimeT::toMicroseconds(this->currentOffset.value);
+    estimates.offset_error = TimeT::toMicroseconds(this->currentOffset.error);
+    return estimates;
+}
+
+/*
+ * Translates local timestamps using the estimates and the constraint lines, with B converted to ns.
+ */
+template<typename TimeT>
+void MiniSync::Estimator<TimeT>::translate(const int64_t* local, size_t count,
+                                           int64_t* reference, int64_t* lower, int64_t* upper) const
+{
+    if (!this->has_constraints)
+        throw std::runtime_error("No constraint lines available!");
+
+    auto line = [](long double A, long double B) -> Translate::Line
+    { return {A, TimeT::toMicroseconds(B).count() * 1000}; };
+
+    Translate::translate(line(this->currentDrift.value, this->currentOffset.value),
+                         line(this->current_low.getA(), this->current_low.getB()),
+                         line(this->current_high.getA(), this->current_high.getB()),
+                         local, count, reference, lower, upper);
+}
+
+/*
+ * Number of processed samples, whether there are constraints, both constraint lines (A, B) with the IDs and x
+ * coordinates of their points, diff_factor, and the drift and offset estimates with their errors.
+ */
+template<typename TimeT>
+void MiniSync::Estimator<TimeT>::saveState(CheckpointWriter& out) const
+{
+    out.put<uint64_t>(this->processed_timestamps);
+    out.put<uint8_t>(this->has_constraints);
+    for (const auto* line: {&this->current_low, &this->current_high})
+    {
+        out.put(line->getA());
+        out.put(line->getB());
+    }
+    for (const auto* pts: {&this->low_constraint_pts, &this->high_constraint_pts})
+    {
+        out.put(pts->low);
+        out.put(pts->high);
+        out.put(pts->low_x);
+        out.put(pts->high_x);
+    }
+    out.put(this->diff_factor);
+    out.put(this->currentDrift.value);
+    out.put(this->currentDrift.error);
+    out.put(this->currentOffset.value);
+    out.put(this->currentOffset.error);
+}
+
+template<typename TimeT>
+void MiniSync::Estimator<TimeT>::loadState(CheckpointReader& in)
+{
+    this->processed_timestamps = in.get<uint64_t>();
+    this->has_constraints = in.get<uint8_t>() != 0;
+    for (auto* line: {&this->current_low, &this->current_high})
+    {
+        const auto A = in.get<real_t>();
+        const auto B = in.get<real_t>();
+        *line = ConstraintLine<TimeT>{A, B};
+    }
+    for (auto* pts: {&this->low_constraint_pts, &this->high_constraint_pts})
+    {
+        pts->low = in.get<PointId>();
+        pts->high = in.get<PointId>();
+        pts->low_x = in.get<point_t>();
+        pts->high_x = in.get<point_t>();
+    }
+    this->diff_factor = in.get<real_t>();
+    this->currentDrift.value = in.get<real_t>();
+    this->currentDrift.error = in.get<real_t>();
+    this->currentOffset.value = in.get<real_t>();
+    this->currentOffset.error = in.get<real_t>();
+}
+
+#endif //MINISYNCPP_ESTIMATOR_H
@@ -0,0 +1,321 @@
+/*
+* Author: Manuel Olguín Muñoz <manuel@olguin.se>
+*
+* Copyright© 2019 Manuel Olguín Muñoz
+* See LICENSE file included in the root directory of this project for licensing and copyright details.
+*/
+
+#ifndef MINISYNCPP_FIXED_MINISYNC_H
+#define MINISYNCPP_FIXED_MINISYNC_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "checkpoint.h"
+#include "estimator.h"
+#include "hull.h"
+#include "minisync_api.h"
+#include "seqlock.h"
+#include "time_types.h"
+
+namespace MiniSync
+{
+    /*
+     * MiniSync with room for at most MaxPoints points in each hull, all stored in arrays inside the object, for
+     * deterministic memory use. It implements the same API::Algorithm interface as the algorithm returned by
+     * API::Factory::createMiniSync(), and never touches the heap except for the vector returned by checkpoint() (and
+     * the exceptions thrown on invalid input), so it can live in a statically allocated object.
+     *
+     * As long as the hulls stay within MaxPoints vertices, which with well-behaved clocks they rarely exceed (see
+     * API::Metrics), the estimates are exactly the same as those of MiniSync. Once a hull is full, its oldest vertex
+     * which does not define one of the current constraint lines is evicted. The current bounds are therefore never
+     * loosened, and since the retained points always include the ones TinySync would keep, the bounds stay at least
+     * as tight as those of TinySync. The constraint and estimate updates themselves are shared with MiniSync through
+     * Estimator.
+     *
+     * The settings in MiniSyncOptions (window and lazy mode) don't apply here. The hot path counters in API::Metrics
+     * are not kept.
+     */
+    template<size_t MaxPoints, typename TimeT = Time::LongDoubleMicroseconds>
+    class FixedMiniSync final : public API::Algorithm, private Estimator<TimeT>
+    {
+        static_assert(MaxPoints >= 2, "FixedMiniSync needs room for at least the two points of each constraint.");
+
+    public:
+        using point_t = typename TimeT::point_t;
+        using real_t = typename TimeT::real_t;
+
+        FixedMiniSync() = default;
+
+        FixedMiniSync(const FixedMiniSync&) = delete;
+        FixedMiniSync& operator=(const FixedMiniSync&) = delete;
+
+        void addDataPoint(us_t To, us_t Tb, us_t Tr) override
+        {
+            this->processDataPoint(TimeT::fromMicroseconds(To),
+                                   TimeT::fromMicroseconds(Tb),
+                                   TimeT::fromMicroseconds(Tr));
+            if (this->processed_timestamps > 1) this->updateEstimates();
+        }
+
+        /*
+         * Processes the data points one by one and updates the estimates only once, which for MiniSync gives the same
+         * results as adding them one at a time.
+         */
+        void addDataPoints(const API::DataPoint* points, size_t count) override
+        {
+            if (count == 0) return;
+            for (size_t i = 0; i < count; ++i)
+                this->processDataPoint(TimeT::fromMicroseconds(points[i].To),
+                                       TimeT::fromMicroseconds(points[i].Tb),
+                                       TimeT::fromMicroseconds(points[i].Tr));
+            if (this->processed_timestamps > 1) this->updateEstimates();
+        }
+
+        long double getDrift() override
+        { return this->currentDrift.value; }
+
+        long double getDriftError() override
+        { return this->currentDrift.error; }
+
+        us_t getOffset() override
+        { return TimeT::toMicroseconds(this->currentOffset.value); }
+
+        us_t getOffsetError() override
+        { return TimeT::toMicroseconds(this->currentOffset.error); }
+
+        void toReferenceTime(const int64_t* local, size_t count,
+                             int64_t* reference, int64_t* lower, int64_t* upper) override;
+
+        std::vector<uint8_t> checkpoint() override;
+
+        /*
+         * Only accepts checkpoints of a FixedMiniSync with the same MaxPoints and time representation.
+         */
+        void restore(const uint8_t* data, size_t size) override;
+
+        API::Estimates getEstimates() override
+        { return this->published.read(); }
+
+        API::Metrics getMetrics() override;
+
+        std::chrono::time_point<std::chrono::system_clock, us_t> getCurrentAdjustedTime() override;
+
+    private:
+        // one more than MaxPoints, for the newest point before evicting
+        FixedHull<TimeT, MaxPoints + 1, true> low_hull{};   // upper hull of the (Tb, To) points
+        FixedHull<TimeT, MaxPoints + 1, false> high_hull{}; // lower hull of the (Tb, Tr) points
+
+        SeqLock<API::Estimates> published; // estimates for concurrent readers
+
+        // "MSCP", in native byte order, like BasicSync
+        static constexpr uint32_t CHECKPOINT_MAGIC = 0x5043534Du;
+        static constexpr uint16_t CHECKPOINT_VERSION = 1;
+        // algorithm IDs 1 and 2 are taken by the retention policies of BasicSync
+        static constexpr uint8_t CHECKPOINT_ID = 3;
+
+        void processDataPoint(point_t To, point_t Tb, point_t Tr);
+        void evict();
+        void updateEstimates();
+
+        // checkpoint helpers, see restore()
+        template<bool Upper>
+        static void readHull(CheckpointReader& in, FixedHull<TimeT, MaxPoints + 1, Upper>& hull);
+
+        template<bool Upper>
+        static bool hasPoint(const FixedHull<TimeT, MaxPoints + 1, Upper>& hull, PointId id, point_t x);
+    };
+}
+
+template<size_t MaxPoints, typename TimeT>
+constexpr uint32_t MiniSync::FixedMiniSync<MaxPoints, TimeT>::CHECKPOINT_MAGIC;
+
+template<size_t MaxPoints, typename TimeT>
+constexpr uint16_t MiniSync::FixedMiniSync<MaxPoints, TimeT>::CHECKPOINT_VERSION;
+
+template<size_t MaxPoints, typename TimeT>
+constexpr uint8_t MiniSync::FixedMiniSync<MaxPoints, TimeT>::CHECKPOINT_ID;
+
+template<size_t MaxPoints, typename TimeT>
+void MiniSync::FixedMiniSync<MaxPoints, TimeT>::processDataPoint(point_t To, point_t Tb, point_t Tr)
+{
+    PointId id = this->processed_timestamps;
+    this->low_hull.insert(Tb, To, id);
+    this->high_hull.insert(Tb, Tr, id);
+    ++this->processed_timestamps;
+
+    if (this->processed_timestamps > 1)
+    {
+        this->tightenConstraints(this->low_hull, this->high_hull, id, To, Tb, Tr);
+        this->evict();
+    }
+}
+
+/*
+ * Evicts the oldest vertices of full hulls, except for the ones defining the current constraints. Any subset of the
+ * vertices of a convex chain is still convex, so the hulls remain valid for the tangent searches.
+ */
+template<size_t MaxPoints, typename TimeT>
+void MiniSync::FixedMiniSync<MaxPoints, TimeT>::evict()
+{
+    auto oldest = [](const PointId* ids, PointId keep1, PointId keep2) -> uint32_t
+    {
+        uint32_t i = 0;
+        while (ids[i] == keep1 || ids[i] == keep2) ++i;
+        return i;
+    };
+
+    // with room for at least two points, there is always a vertex which isn't protected
+    while (this->low_hull.n > MaxPoints)
+        this->low_hull.erase(oldest(this->low_hull.ids, this->low_constraint_pts.low, this->high_constraint_pts.low));
+    while (this->high_hull.n > MaxPoints)
+        this->high_hull.erase(oldest(this->high_hull.ids, this->low_constraint_pts.high,
+                                     this->high_constraint_pts.high));
+}
+
+/*
+ * See Estimator::updateEstimates(), then publishes the estimates for getEstimates() and getCurrentAdjustedTime().
+ */
+template<size_t MaxPoints, typename TimeT>
+void MiniSync::FixedMiniSync<MaxPoints, TimeT>::updateEstimates()
+{
+    Estimator<TimeT>::updateEstimates();
+    this->published.publish(this->estimates());
+}
+
+template<size_t MaxPoints, typename TimeT>
+void MiniSync::FixedMiniSync<MaxPoints, TimeT>::toReferenceTime(const int64_t* local, size_t count,
+                                                                int64_t* reference, int64_t* lower, int64_t* upper)
+{
+    this->translate(local, count, reference, lower, upper);
+}
+
+template<size_t MaxPoints, typename TimeT>
+MiniSync::API::Metrics MiniSync::FixedMiniSync<MaxPoints, TimeT>::getMetrics()
+{
+    API::Metrics metrics;
+    metrics.samples = this->processed_timestamps;
+    metrics.low_points = this->low_hull.n;
+    metrics.high_points = this->high_hull.n;
+    metrics.constraints = this->has_constraints ? 2 : 0;
+    return metrics;
+}
+
+template<size_t MaxPoints, typename TimeT>
+std::chrono::time_point<std::chrono::system_clock, MiniSync::us_t>
+MiniSync::FixedMiniSync<MaxPoints, TimeT>::getCurrentAdjustedTime()
+{
+    const us_t t_now = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::time_point<std::chrono::system_clock, us_t>{API::toReference(this->published.read(), t_now)};
+}
+
+/*
+ * Checkpoint layout (version 1), all in native byte order: the same header as BasicSync plus MaxPoints, then the
+ * number of processed samples, the constraints and estimates as in BasicSync, and the vertices of both hulls.
+ */
+template<size_t MaxPoints, typename TimeT>
+std::vector<uint8_t> MiniSync::FixedMiniSync<MaxPoints, TimeT>::checkpoint()
+{
+    std::vector<uint8_t> out;
+    CheckpointWriter writer{out};
+    writer.put(CHECKPOINT_MAGIC);
+    writer.put(CHECKPOINT_VERSION);
+    writer.put(CHECKPOINT_ID);
+    writer.put(TimeT::checkpointId());
+    writer.put<uint8_t>(checkpointSize<point_t>());
+    writer.put<uint8_t>(checkpointSize<real_t>());
+    writer.put<uint32_t>(MaxPoints);
+
+    this->saveState(writer);
+    writer.put(this->low_hull.n);
+    writer.putArray(this->low_hull.xs, this->low_hull.n);
+    writer.putArray(this->low_hull.ys, this->low_hull.n);
+    writer.putArray(this->low_hull.ids, this->low_hull.n);
+    writer.put(this->high_hull.n);
+    writer.putArray(this->high_hull.xs, this->high_hull.n);
+    writer.putArray(this->high_hull.ys, this->high_hull.n);
+    writer.putArray(this->high_hull.ids, this->high_hull.n);
+    return out;
+}
+
+template<size_t MaxPoints, typename TimeT>
+void MiniSync::FixedMiniSync<MaxPoints, TimeT>::restore(const uint8_t* data, size_t size)
+{
+    CheckpointReader reader{data, size};
+    if (reader.get<uint32_t>() != CHECKPOINT_MAGIC)
+        throw std::invalid_argument("Not a checkpoint, or taken on a platform with different byte order.");
+    if (reader.get<uint16_t>() != CHECKPOINT_VERSION)
+        throw std::invalid_argument("Unsupported checkpoint version.");
+    if (reader.get<uint8_t>() != CHECKPOINT_ID)
+        throw std::invalid_argument("Checkpoint was taken from a different algorithm.");
+    if (reader.get<uint8_t>() != TimeT::checkpointId())
+        throw std::invalid_argument("Checkpoint was taken with a different time representation.");
+    if (reader.get<uint8_t>() != checkpointSize<point_t>() || reader.get<uint8_t>() != checkpointSize<real_t>())
+        throw std::invalid_argument("Checkpoint was taken on a platform with different type sizes.");
+    if (reader.get<uint32_t>() != MaxPoints)
+        throw std::invalid_argument("Checkpoint was taken with a different maximum number of points.");
+
+    // everything is read into temporaries first, so that a corrupt checkpoint leaves the algorithm untouched
+    Estimator<TimeT> state;
+    state.loadState(reader);
+    FixedHull<TimeT, MaxPoints + 1, true> low{};
+    FixedHull<TimeT, MaxPoints + 1, false> high{};
+    readHull(reader, low);
+    readHull(reader, high);
+    if (reader.left() != 0)
+        throw std::invalid_argument("Corrupt checkpoint: trailing data.");
+
+    // evict() never drops the points of the current constraints, so they have to be there
+    if (state.has_constraints &&
+        !(hasPoint(low, state.low_constraint_pts.low, state.low_constraint_pts.low_x) &&
+          hasPoint(low, state.high_constraint_pts.low, state.high_constraint_pts.low_x) &&
+          hasPoint(high, state.low_constraint_pts.high, state.low_constraint_pts.high_x) &&
+          hasPoint(high, state.high_constraint_pts.high, state.high_constraint_pts.high_x)))
+        throw std::invalid_argument("Corrupt checkpoint: constraint points are not in the hulls.");
+
+    static_cast<Estimator<TimeT>&>(*this) = state;
+    this->low_hull = low;
+    this->high_hull = high;
+    this->published.publish(this->estimates());
+}
+
+/*
+ * Reads the vertices of a hull into an empty one, rebuilding it through insert() like Hull::load(), so that points
+ * which don't form a convex chain are rejected instead of breaking the tangent searches.
+ */
+template<size_t MaxPoints, typename TimeT>
+template<bool Upper>
+void MiniSync::FixedMiniSync<MaxPoints, TimeT>::readHull(CheckpointReader& in,
+                                                         FixedHull<TimeT, MaxPoints + 1, Upper>& hull)
+{
+    FixedHull<TimeT, MaxPoints + 1, Upper> stored{};
+    stored.n = in.get<uint32_t>();
+    if (stored.n > MaxPoints)
+        throw std::invalid_argument("Corrupt checkpoint: too many points.");
+    in.getArray(stored.xs, stored.n);
+    in.getArray(stored.ys, stored.n);
+    in.getArray(stored.ids, stored.n);
+    for (uint32_t i = 1; i < stored.n; ++i)
+        if (!(stored.xs[i - 1] < stored.xs[i]))
+            throw std::invalid_argument("Corrupt checkpoint: points out of order.");
+
+    for (uint32_t i = 0; i < stored.n; ++i)
+        if (!hull.insert(stored.xs[i], stored.ys[i], stored.ids[i]))
+            throw std::invalid_argument("Corrupt checkpoint: invalid point.");
+    if (hull.n != stored.n)
+        throw std::invalid_argument("Corrupt checkpoint: points are not a convex hull.");
+}
+
+template<size_t MaxPoints, typename TimeT>
+template<bool Upper>
+bool MiniSync::FixedMiniSync<MaxPoints, TimeT>::hasPoint(const FixedHull<TimeT, MaxPoints + 1, Upper>& hull,
+                                                         PointId id, point_t x)
+{
+    for (uint32_t i = 0; i < hull.n; ++i)
+        if (hull.ids[i] == id) return hull.xs[i] == x;
+    return false;
+}
+
+#endif //MINISYNCPP_FIXED_MINISYNC_H
@@ -0,0 +1,199 @@
+/*
+* Author: Manuel Olguín Muñoz <manuel@olguin.se>
+*
+* Copyright© 2019 Manuel Olguín Muñoz
+* See LICENSE file included in the root directory of this project for licensing and copyright details.
+*/
+
+#ifndef MINISYNCPP_FIXED_TINYSYNC_H
+#define MINISYNCPP_FIXED_TINYSYNC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include "hull.h"
+#include "time_types.h"
+
+namespace MiniSync
+{
+    /*
+     * TinySync with its whole state in a fixed-size POD: at most three points of each hull (the ones defining the
+     * current constraints, plus the newest), the two constraint lines and the estimates. It never allocates nor
+     * throws, so it can be embedded anywhere, down to microcontrollers, and copied or stored with memcpy.
+     *
+     * Gives exactly the same estimates as BasicSync<Retention::TinySync, TimeT> with the same samples added one at
+     * a time (and as the algorithm returned by API::Factory::createTinySync() in eager mode). Instead of throwing,
+     * addDataPoint() returns false when the estimates can't be updated.
+     *
+     * A value-initialized instance (FixedTinySync<> sync{};) is ready for use, as is any instance after reset().
+     */
+    template<typename TimeT = Time::LongDoubleMicroseconds>
+    class FixedTinySync
+    {
+    public:
+        using point_t = typename TimeT::point_t;
+        using real_t = typename TimeT::real_t;
+
+        void reset()
+        { *this = FixedTinySync{}; }
+
+        /*
+         * Adds a data point and recalculates offset and drift. Returns false if there are no constraint lines yet (the
+         * estimates keep their previous values) or the new estimates are invalid (negative drift, in which case they
+         * are not stored either).
+         */
+        bool addDataPoint(point_t To, point_t Tb, point_t Tr);
+
+        /*
+         * Current estimated relative clock drift and offset (in the units of the timestamps), with their errors.
+         */
+        real_t getDrift() const
+        { return this->estimated ? this->drift : 1; }
+
+        real_t getDriftError() const
+        { return this->drift_error; }
+
+        real_t getOffset() const
+        { return this->offset; }
+
+        real_t getOffsetError() const
+        { return this->offset_error; }
+
+        bool hasConstraints() const
+        { return this->has_constraints; }
+
+        uint64_t processedSamples() const
+        { return this->processed; }
+
+    private:
+        // y = A * x + B
+        struct Line
+        {
+            real_t A;
+            real_t B;
+        };
+
+        // the hulls hold at most two points before each insertion
+        FixedHull<TimeT, 3, true> low;   // upper hull of the (Tb, To) points
+        FixedHull<TimeT, 3, false> high; // lower hull of the (Tb, Tr) points
+
+        Line current_low;
+        Line current_high;
+        PointId low_ids[2];  // low and high point of current_low
+        PointId high_ids[2]; // low and high point of current_high
+        real_t diff_factor;  // only meaningful with has_constraints
+
+        real_t drift;
+        real_t drift_error;
+        real_t offset;
+        real_t offset_error;
+
+        uint64_t processed;
+        bool has_constraints;
+        bool estimated;
+
+        static Line line(point_t low_x, point_t low_y, point_t high_x, point_t high_y);
+    };
+}
+
+/*
+ * Line through a low and a high point, computed like ConstraintLine. The points never share their x coordinate, as
+ * tangents are only searched for among the points to the left.
+ */
+template<typename TimeT>
+typename MiniSync::FixedTinySync<TimeT>::Line MiniSync::FixedTinySync<TimeT>::line(point_t low_x, point_t low_y,
+                                                                                   point_t high_x, point_t high_y)
+{
+    Line l;
+    l.A = static_cast<real_t>(high_y - low_y) / static_cast<real_t>(high_x - low_x);
+    l.B = static_cast<real_t>(low_y) - (l.A * static_cast<real_t>(low_x));
+    return l;
+}
+
+/*
+ * Same steps as BasicSync::processDataPoint(), __recalculateConstraints(), TinySync::cleanup() and updateEstimates().
+ */
+template<typename TimeT>
+bool MiniSync::FixedTinySync<TimeT>::addDataPoint(point_t To, point_t Tb, point_t Tr)
+{
+    const PointId id = static_cast<PointId>(this->processed);
+    this->low.insert(Tb, To, id);
+    this->high.insert(Tb, Tr, id);
+    if (++this->processed == 1) return false;
+
+    // new lines through the newest points, tangent to the hulls
+    Line lows[2] = {this->current_low, {0, 0}};
+    Line highs[2] = {this->current_high, {0, 0}};
+    bool found_low = false;
+    bool found_high = false;
+
+    uint32_t low_idx = this->low.findTangent(Tb, Tr);
+    if (low_idx < this->low.n)
+    {
+        lows[1] = line(this->low.xs[low_idx], this->low.ys[low_idx], Tb, Tr);
+        found_low = true;
+    }
+    uint32_t high_idx = this->high.findTangent(Tb, To);
+    if (high_idx < this->high.n)
+    {
+        highs[1] = line(Tb, To, this->high.xs[high_idx], this->high.ys[high_idx]);
+        found_high = true;
+    }
+
+    // compare every combination involving at least one new line, in the same order as BasicSync
+    real_t best = this->has_constraints ? this->diff_factor : std::numeric_limits<real_t>::max();
+    uint32_t best_low = 0;
+    uint32_t best_high = 0;
+    const bool available_low[2] = {this->has_constraints, found_low};
+    const bool available_high[2] = {this->has_constraints, found_high};
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        for (uint32_t j = 0; j < 2; ++j)
+        {
+            if ((i == 0 && j == 0) || !available_low[i] || !available_high[j]) continue;
+            const real_t diff = (lows[i].A - highs[j].A) * (highs[j].B - lows[i].B);
+            if (diff < best)
+            {
+                best = diff;
+                best_low = i;
+                best_high = j;
+            }
+        }
+    }
+
+    if (best_low != 0)
+    {
+        this->current_low = lows[1];
+        this->low_ids[0] = this->low.ids[low_idx];
+        this->low_ids[1] = id;
+    }
+    if (best_high != 0)
+    {
+        this->current_high = highs[1];
+        this->high_ids[0] = id;
+        this->high_ids[1] = this->high.ids[high_idx];
+    }
+    if (best_low != 0 || best_high != 0)
+    {
+        this->diff_factor = best;
+        this->has_constraints = true;
+    }
+
+    // only keep the points of the current constraints
+    this->low.retain(this->low_ids[0], this->high_ids[0]);
+    this->high.retain(this->low_ids[1], this->high_ids[1]);
+
+    if (!this->has_constraints) return false;
+
+    const real_t new_drift = (this->current_low.A + this->current_high.A) / 2;
+    if (new_drift < 0) return false;
+
+    this->drift = new_drift;
+    this->offset = (this->current_low.B + this->current_high.B) / 2;
+    this->drift_error = (this->current_low.A - this->current_high.A) / 2;
+    this->offset_error = (this->current_high.B - this->current_low.B) / 2;
+    this->estimated = true;
+    return true;
+}
+
+#endif //MINISYNCPP_FIXED_TINYSYNC_H
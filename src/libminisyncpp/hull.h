@@ -0,0 +1,700 @@
+/*
+* Author: Manuel Olguín Muñoz <manuel@olguin.se>
+*
+* Copyright© 2019 Manuel Olguín Muñoz
+* See LICENSE file included in the root directory of this project for licensing and copyright details.
+*/
+
+#ifndef MINISYNCPP_HULL_H
+#define MINISYNCPP_HULL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "checkpoint.h"
+#include "time_types.h"
+
+namespace MiniSync
+{
+    // points are identified by the index of the sample they were created from
+    using PointId = uint32_t;
+
+    /*
+     * Convex hull of a set of points, ordered by x coordinate.
+     *
+     * Low points are kept in an upper hull and high points in a lower hull, since the tightest constraint lines are
+     * always tangent to these. Coordinates (timestamps, in the representation given by TimeT) and point IDs are stored
+     * in separate contiguous arrays, so that searches only touch the data they actually need.
+     *
+     * A windowed hull also allows removing its oldest points. Since a point inside the hull can become a vertex again
+     * once older points are gone, a windowed hull keeps every point it is given, split in two blocks like a queue made
+     * of two stacks: new points are appended to the back block, which keeps its hull as usual, while the front block
+     * holds the hulls of all its suffixes, so its oldest point can be popped in amortized O(1) time. Once the front
+     * block runs out, the whole back block is moved into it. The vertices of the hull of the window are always among
+     * the vertices of both block hulls, which are indexed together: first the front block, then the back block.
+     */
+    template<typename TimeT>
+    class Hull
+    {
+    public:
+        using point_t = typename TimeT::point_t;
+        using wide_t = typename TimeT::wide_t;
+
+        explicit Hull(bool upper, bool windowed = false) :
+            upper(upper), windowed(windowed), front_top(0), front_first(0)
+        {};
+
+        size_t size() const
+        { return this->frontSize() + this->xs.size(); }
+
+        bool empty() const
+        { return this->size() == 0; }
+
+        point_t getX(size_t i) const
+        { return i < this->frontSize() ? this->front_xs[this->front_top + i] : this->xs[i - this->frontSize()]; }
+
+        point_t getY(size_t i) const
+        { return i < this->frontSize() ? this->front_ys[this->front_top + i] : this->ys[i - this->frontSize()]; }
+
+        PointId getId(size_t i) const
+        { return i < this->frontSize() ? this->front_ids[this->front_top + i] : this->ids[i - this->frontSize()]; }
+
+        /*
+         * Inserts a point, removing the vertices that stop being part of the hull.
+         * Returns false if the point was not stored.
+         */
+        bool insert(point_t x, point_t y, PointId id);
+
+        /*
+         * Finds the vertex which forms the line with minimum (upper hull) or maximum (lower hull) slope together with
+         * point (x, y). Returns size() if no vertex lies to the left of the point.
+         */
+        size_t findTangent(point_t x, point_t y) const;
+
+        /*
+         * Removes every vertex except the ones with the given IDs. Not available on windowed hulls.
+         */
+        void retain(PointId id1, PointId id2);
+
+        /*
+         * Number of points stored in a windowed hull, including the ones which are currently not vertices.
+         */
+        size_t pointCount() const;
+
+        /*
+         * Oldest (i.e. leftmost) point stored in a windowed hull. The hull must not be empty.
+         */
+        point_t getOldestX() const;
+        PointId getOldestId() const;
+
+        /*
+         * Removes the oldest point from a windowed hull in amortized O(1) time.
+         */
+        void popOldest();
+
+        void clear();
+
+        /*
+         * Reserves room for n points (n stored points for windowed hulls), so that inserting and popping points
+         * allocates no memory as long as the hull stays within that size.
+         */
+        void reserve(size_t n);
+
+        /*
+         * Heap memory held by the hull, including spare capacity.
+         */
+        size_t memoryBytes() const;
+
+        /*
+         * Writes the stored points to a checkpoint: the vertices, or every point in the window for windowed hulls.
+         */
+        void save(CheckpointWriter& out) const;
+
+        /*
+         * Replaces the contents of the hull with the points in a checkpoint written by save(), in O(n) time for n
+         * points. Throws std::invalid_argument if the checkpoint does not hold a valid hull of the same kind.
+         */
+        void load(CheckpointReader& in);
+
+    private:
+        bool upper;
+        bool windowed;
+
+        // hull of the back block
+        std::vector<point_t> xs;
+        std::vector<point_t> ys;
+        std::vector<PointId> ids;
+
+        // every point in the back block, in order
+        std::vector<point_t> back_xs;
+        std::vector<point_t> back_ys;
+        std::vector<PointId> back_ids;
+
+        // hull of the front block, occupying the end of the arrays from front_top on
+        size_t front_top;
+        std::vector<point_t> front_xs;
+        std::vector<point_t> front_ys;
+        std::vector<PointId> front_ids;
+
+        // every point in the front block from front_first on, with the number of vertices each of them removed from
+        // the hull of the front block when it was added; the removed vertices themselves are kept on a stack
+        size_t front_first;
+        std::vector<point_t> points_xs;
+        std::vector<point_t> points_ys;
+        std::vector<PointId> points_ids;
+        std::vector<uint32_t> points_removed;
+        std::vector<point_t> removed_xs;
+        std::vector<point_t> removed_ys;
+        std::vector<PointId> removed_ids;
+
+        size_t frontSize() const
+        { return this->front_xs.size() - this->front_top; }
+
+        bool isConvex(point_t ox, point_t oy,
+                      point_t ax, point_t ay,
+                      point_t bx, point_t by) const;
+        size_t findTangent(const point_t* hx, const point_t* hy, size_t n, point_t x, point_t y) const;
+        void erase(size_t i);
+        void moveBackToFront();
+        void buildFront();
+    };
+
+    /*
+     * Hull with room for at most N points in inline arrays, with the same insertion and tangent search as a plain
+     * Hull, for the algorithms which never touch the heap. Upper selects an upper hull (for low points) or a lower
+     * hull (for high points). A POD, so a value-initialized instance is an empty hull.
+     */
+    template<typename TimeT, size_t N, bool Upper>
+    struct FixedHull
+    {
+        using point_t = typename TimeT::point_t;
+        using wide_t = typename TimeT::wide_t;
+
+        point_t xs[N];
+        point_t ys[N];
+        PointId ids[N];
+        uint32_t n;
+
+        // same accessors as Hull
+        size_t size() const
+        { return this->n; }
+
+        point_t getX(size_t i) const
+        { return this->xs[i]; }
+
+        point_t getY(size_t i) const
+        { return this->ys[i]; }
+
+        PointId getId(size_t i) const
+        { return this->ids[i]; }
+
+        /*
+         * Same as Hull::insert(). There must be room for one more point.
+         */
+        bool insert(point_t x, point_t y, PointId id);
+
+        /*
+         * Same as Hull::findTangent(), returns n if no vertex lies to the left of the point.
+         */
+        uint32_t findTangent(point_t x, point_t y) const;
+
+        // same as Hull::retain()
+        void retain(PointId id1, PointId id2);
+
+        void erase(uint32_t i);
+
+        bool isConvex(point_t ox, point_t oy,
+                      point_t ax, point_t ay,
+                      point_t bx, point_t by) const;
+    };
+}
+
+/*
+ * Checks that o, a, b make a valid turn for the hull: clockwise for upper hulls and counter-clockwise for lower hulls.
+ * Collinear points are not valid, as the middle point adds no information.
+ */
+template<typename TimeT>
+bool MiniSync::Hull<TimeT>::isConvex(point_t ox, point_t oy,
+                                     point_t ax, point_t ay,
+                                     point_t bx, point_t by) const
+{
+    // cross product of o->a and o->b, positive for counter-clockwise turns
+    wide_t turn = static_cast<wide_t>(ax - ox) * (by - oy) - static_cast<wide_t>(ay - oy) * (bx - ox);
+    return this->upper ? turn < 0 : turn > 0;
+}
+
+template<typename TimeT>
+void MiniSync::Hull<TimeT>::erase(size_t i)
+{
+    this->xs.erase(this->xs.begin() + i);
+    this->ys.erase(this->ys.begin() + i);
+    this->ids.erase(this->ids.begin() + i);
+}
+
+/*
+ * Inserts a point into the hull, removing the vertices that stop being part of it.
+ * Points are expected to arrive in time order, in which case this is an amortized O(1) append.
+ *
+ * Returns false if the point was not stored, either because it lies inside the hull or because there already is a
+ * point with the same x coordinate. Windowed hulls store every point, except for those which are older than the ones
+ * which already left the back block.
+ */
+template<typename TimeT>
+bool MiniSync::Hull<TimeT>::insert(point_t x, point_t y, PointId id)
+{
+    if (this->windowed)
+    {
+        if (this->front_first < this->points_xs.size() && x <= this->points_xs.back())
+            return false;
+
+        size_t idx = std::lower_bound(this->back_xs.begin(), this->back_xs.end(), x) - this->back_xs.begin();
+        if (idx < this->back_xs.size() && this->back_xs[idx] == x)
+            return false;
+        this->back_xs.insert(this->back_xs.begin() + idx, x);
+        this->back_ys.insert(this->back_ys.begin() + idx, y);
+        this->back_ids.insert(this->back_ids.begin() + idx, id);
+    }
+
+    size_t n = this->xs.size();
+    if (n == 0 || this->xs[n - 1] < x)
+    {
+        // fast path: append at the right end
+        while (n >= 2 && !isConvex(xs[n - 2], ys[n - 2], xs[n - 1], ys[n - 1], x, y))
+            --n;
+        this->xs.resize(n);
+        this->ys.resize(n);
+        this->ids.resize(n);
+
+        this->xs.push_back(x);
+        this->ys.push_back(y);
+        this->ids.push_back(id);
+        return true;
+    }
+
+    // out of order point
+    size_t idx = std::lower_bound(this->xs.begin(), this->xs.end(), x) - this->xs.begin();
+    if (xs[idx] == x)
+        return this->windowed;
+    if (idx > 0 && !isConvex(xs[idx - 1], ys[idx - 1], x, y, xs[idx], ys[idx]))
+        return this->windowed; // inside the hull
+
+    this->xs.insert(this->xs.begin() + idx, x);
+    this->ys.insert(this->ys.begin() + idx, y);
+    this->ids.insert(this->ids.begin() + idx, id);
+
+    while (idx >= 2 && !isConvex(xs[idx - 2], ys[idx - 2], xs[idx - 1], ys[idx - 1], x, y))
+        this->erase(--idx);
+    while (idx + 2 < this->xs.size() && !isConvex(x, y, xs[idx + 1], ys[idx + 1], xs[idx + 2], ys[idx + 2]))
+        this->erase(idx + 1);
+    return true;
+}
+
+/*
+ * Finds the vertex of a convex chain of n vertices (strictly to the left of point p) which, together with p, forms the
+ * line with the minimum (upper hull) or maximum (lower hull) slope. Seen from a point to the right of the chain, the
+ * slopes of the lines to its vertices are unimodal, so a binary search suffices.
+ *
+ * Returns n if no vertex lies to the left of p.
+ */
+template<typename TimeT>
+size_t MiniSync::Hull<TimeT>::findTangent(const point_t* hx, const point_t* hy, size_t n,
+                                          point_t x, point_t y) const
+{
+    // only vertices with x < p.x can form a constraint with p
+    size_t count = std::lower_bound(hx, hx + n, x) - hx;
+    if (count == 0) return n;
+
+    // search for the first vertex i where moving on to i + 1 stops improving the slope
+    size_t lo = 0;
+    size_t hi = count - 1;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        // compare slope(v_mid, p) against slope(v_mid+1, p), both denominators are positive
+        wide_t s_mid = static_cast<wide_t>(y - hy[mid]) * (x - hx[mid + 1]);
+        wide_t s_next = static_cast<wide_t>(y - hy[mid + 1]) * (x - hx[mid]);
+        if ((upper && s_mid <= s_next) || (!upper && s_mid >= s_next))
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
+
+/*
+ * Finds the vertex of the hull which, together with p, forms the line with the minimum (upper hull) or maximum (lower
+ * hull) slope, checking both blocks of windowed hulls.
+ *
+ * Returns size() if no vertex lies to the left of p.
+ */
+template<typename TimeT>
+size_t MiniSync::Hull<TimeT>::findTangent(point_t x, point_t y) const
+{
+    const size_t front = this->frontSize();
+    size_t back = this->findTangent(this->xs.data(), this->ys.data(), this->xs.size(), x, y);
+    if (front == 0)
+        return back == this->xs.size() ? this->size() : back;
+
+    size_t i = this->findTangent(this->front_xs.data() + this->front_top, this->front_ys.data() + this->front_top,
+                                 front, x, y);
+    if (back == this->xs.size()) return i == front ? this->size() : i;
+    if (i == front) return front + back;
+
+    // keep the better of both, comparing slopes as above
+    wide_t s_front = static_cast<wide_t>(y - getY(i)) * (x - xs[back]);
+    wide_t s_back = static_cast<wide_t>(y - ys[back]) * (x - getX(i));
+    if ((upper && s_front <= s_back) || (!upper && s_front >= s_back))
+        return i;
+    return front + back;
+}
+
+template<typename TimeT>
+void MiniSync::Hull<TimeT>::retain(PointId id1, PointId id2)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < this->xs.size(); ++i)
+    {
+        if (this->ids[i] != id1 && this->ids[i] != id2) continue;
+        this->xs[n] = this->xs[i];
+        this->ys[n] = this->ys[i];
+        this->ids[n] = this->ids[i];
+        ++n;
+    }
+    this->xs.resize(n);
+    this->ys.resize(n);
+    this->ids.resize(n);
+}
+
+template<typename TimeT>
+size_t MiniSync::Hull<TimeT>::pointCount() const
+{
+    return this->points_xs.size() - this->front_first + this->back_xs.size();
+}
+
+template<typename TimeT>
+void MiniSync::Hull<TimeT>::reserve(size_t n)
+{
+    this->xs.reserve(n);
+    this->ys.reserve(n);
+    this->ids.reserve(n);
+    if (!this->windowed) return;
+
+    // the blocks trade places in moveBackToFront(), so both need the same room
+    for (auto* v: {&this->back_xs, &this->back_ys, &this->front_xs, &this->front_ys,
+                   &this->points_xs, &this->points_ys, &this->removed_xs, &this->removed_ys})
+        v->reserve(n);
+    for (auto* v: {&this->back_ids, &this->front_ids, &this->points_ids, &this->removed_ids})
+        v->reserve(n);
+    this->points_removed.reserve(n);
+}
+
+template<typename TimeT>
+size_t MiniSync::Hull<TimeT>::memoryBytes() const
+{
+    size_t points = 0;
+    size_t ids = 0;
+    for (const auto* v: {&this->xs, &this->ys, &this->back_xs, &this->back_ys, &this->front_xs, &this->front_ys,
+                         &this->points_xs, &this->points_ys, &this->removed_xs, &this->removed_ys})
+        points += v->capacity();
+    for (const auto* v: {&this->ids, &this->back_ids, &this->front_ids, &this->points_ids, &this->removed_ids})
+        ids += v->capacity();
+    return points * sizeof(point_t) + ids * sizeof(PointId) + this->points_removed.capacity() * sizeof(uint32_t);
+}
+
+template<typename TimeT>
+typename MiniSync::Hull<TimeT>::point_t MiniSync::Hull<TimeT>::getOldestX() const
+{
+    return this->front_first < this->points_xs.size() ? this->points_xs[this->front_first] : this->back_xs.front();
+}
+
+template<typename TimeT>
+MiniSync::PointId MiniSync::Hull<TimeT>::getOldestId() const
+{
+    return this->front_first < this->points_xs.size() ? this->points_ids[this->front_first] : this->back_ids.front();
+}
+
+/*
+ * Moves every point in the back block to the (empty) front block.
+ */
+template<typename TimeT>
+void MiniSync::Hull<TimeT>::moveBackToFront()
+{
+    this->points_xs.swap(this->back_xs);
+    this->points_ys.swap(this->back_ys);
+    this->points_ids.swap(this->back_ids);
+    this->buildFront();
+
+    this->back_xs.clear();
+    this->back_ys.clear();
+    this->back_ids.clear();
+    this->xs.clear();
+    this->ys.clear();
+    this->ids.clear();
+}
+
+/*
+ * Builds the hulls of all suffixes of the points in the front block, from right to left. Each point added on the left
+ * can only remove vertices from the left end of the hull, which are saved so they can be restored once the point is
+ * popped again.
+ */
+template<typename TimeT>
+void MiniSync::Hull<TimeT>::buildFront()
+{
+    const size_t n = this->points_xs.size();
+    this->points_removed.resize(n);
+    this->front_first = 0;
+
+    this->front_xs.resize(n);
+    this->front_ys.resize(n);
+    this->front_ids.resize(n);
+    this->front_top = n;
+
+    this->removed_xs.clear();
+    this->removed_ys.clear();
+    this->removed_ids.clear();
+
+    point_t* fx = this->front_xs.data();
+    point_t* fy = this->front_ys.data();
+    for (size_t k = n; k-- > 0;)
+    {
+        const point_t x = this->points_xs[k];
+        const point_t y = this->points_ys[k];
+
+        uint32_t removed = 0;
+        while (n - this->front_top >= 2 &&
+               !isConvex(x, y, fx[front_top], fy[front_top], fx[front_top + 1], fy[front_top + 1]))
+        {
+            this->removed_xs.push_back(fx[front_top]);
+            this->removed_ys.push_back(fy[front_top]);
+            this->removed_ids.push_back(this->front_ids[front_top]);
+            ++this->front_top;
+            ++removed;
+        }
+
+        --this->front_top;
+        fx[front_top] = x;
+        fy[front_top] = y;
+        this->front_ids[front_top] = this->points_ids[k];
+        this->points_removed[k] = removed;
+    }
+}
+
+template<typename TimeT>
+void MiniSync::Hull<TimeT>::popOldest()
+{
+    if (this->front_first == this->points_xs.size())
+        this->moveBackToFront();
+
+    // the oldest point is always the leftmost vertex of the front hull; popping it restores the vertices it removed
+    ++this->front_top;
+    for (uint32_t k = this->points_removed[this->front_first]; k > 0; --k)
+    {
+        --this->front_top;
+        this->front_xs[front_top] = this->removed_xs.back();
+        this->front_ys[front_top] = this->removed_ys.back();
+        this->front_ids[front_top] = this->removed_ids.back();
+        this->removed_xs.pop_back();
+        this->removed_ys.pop_back();
+        this->removed_ids.pop_back();
+    }
+    ++this->front_first;
+}
+
+template<typename TimeT>
+void MiniSync::Hull<TimeT>::clear()
+{
+    this->xs.clear();
+    this->ys.clear();
+    this->ids.clear();
+    this->back_xs.clear();
+    this->back_ys.clear();
+    this->back_ids.clear();
+    this->front_top = 0;
+    this->front_xs.clear();
+    this->front_ys.clear();
+    this->front_ids.clear();
+    this->front_first = 0;
+    this->points_xs.clear();
+    this->points_ys.clear();
+    this->points_ids.clear();
+    this->points_removed.clear();
+    this->removed_xs.clear();
+    this->removed_ys.clear();
+    this->removed_ids.clear();
+}
+
+/*
+ * A windowed hull is saved as the points of both blocks, and restored by rebuilding the front block from its points
+ * and inserting the back block again. Both give exactly the same hulls as before, as the suffix hulls of the front
+ * block do not depend on points which were already popped from it.
+ */
+template<typename TimeT>
+void MiniSync::Hull<TimeT>::save(CheckpointWriter& out) const
+{
+    out.put<uint8_t>(this->windowed);
+    if (this->windowed)
+    {
+        const size_t front = this->points_xs.size() - this->front_first;
+        out.put<uint32_t>(front);
+        out.putArray(this->points_xs.data() + this->front_first, front);
+        out.putArray(this->points_ys.data() + this->front_first, front);
+        out.putArray(this->points_ids.data() + this->front_first, front);
+        out.put<uint32_t>(this->back_xs.size());
+        out.putArray(this->back_xs.data(), this->back_xs.size());
+        out.putArray(this->back_ys.data(), this->back_ys.size());
+        out.putArray(this->back_ids.data(), this->back_ids.size());
+    }
+    else
+    {
+        out.put<uint32_t>(this->xs.size());
+        out.putArray(this->xs.data(), this->xs.size());
+        out.putArray(this->ys.data(), this->ys.size());
+        out.putArray(this->ids.data(), this->ids.size());
+    }
+}
+
+template<typename TimeT>
+void MiniSync::Hull<TimeT>::load(CheckpointReader& in)
+{
+    if (in.get<uint8_t>() != static_cast<uint8_t>(this->windowed))
+        throw std::invalid_argument("Checkpoint was taken with a different window setting.");
+
+    this->clear();
+    std::vector<point_t> load_xs;
+    std::vector<point_t> load_ys;
+    std::vector<PointId> load_ids;
+    auto read = [&]()
+    {
+        const uint32_t n = in.get<uint32_t>();
+        // don't trust the count before knowing the data is actually there
+        if (n > in.left() / (2 * checkpointSize<point_t>() + checkpointSize<PointId>()))
+            throw std::invalid_argument("Truncated checkpoint.");
+        load_xs.resize(n);
+        load_ys.resize(n);
+        load_ids.resize(n);
+        in.getArray(load_xs.data(), n);
+        in.getArray(load_ys.data(), n);
+        in.getArray(load_ids.data(), n);
+        for (size_t i = 1; i < n; ++i)
+            if (!(load_xs[i - 1] < load_xs[i]))
+                throw std::invalid_argument("Corrupt checkpoint: points out of order.");
+    };
+
+    if (this->windowed)
+    {
+        read();
+        this->points_xs.swap(load_xs);
+        this->points_ys.swap(load_ys);
+        this->points_ids.swap(load_ids);
+        this->buildFront();
+    }
+
+    read();
+    for (size_t i = 0; i < load_xs.size(); ++i)
+        if (!this->insert(load_xs[i], load_ys[i], load_ids[i]))
+            throw std::invalid_argument("Corrupt checkpoint: invalid point.");
+    if (!this->windowed && this->xs.size() != load_xs.size())
+        throw std::invalid_argument("Corrupt checkpoint: points are not a convex hull.");
+}
+
+template<typename TimeT, size_t N, bool Upper>
+bool MiniSync::FixedHull<TimeT, N, Upper>::isConvex(point_t ox, point_t oy,
+                                                    point_t ax, point_t ay,
+                                                    point_t bx, point_t by) const
+{
+    wide_t turn = static_cast<wide_t>(ax - ox) * (by - oy) - static_cast<wide_t>(ay - oy) * (bx - ox);
+    return Upper ? turn < 0 : turn > 0;
+}
+
+template<typename TimeT, size_t N, bool Upper>
+void MiniSync::FixedHull<TimeT, N, Upper>::erase(uint32_t i)
+{
+    for (; i + 1 < this->n; ++i)
+    {
+        this->xs[i] = this->xs[i + 1];
+        this->ys[i] = this->ys[i + 1];
+        this->ids[i] = this->ids[i + 1];
+    }
+    --this->n;
+}
+
+template<typename TimeT, size_t N, bool Upper>
+bool MiniSync::FixedHull<TimeT, N, Upper>::insert(point_t x, point_t y, PointId id)
+{
+    uint32_t i = 0;
+    while (i < this->n && this->xs[i] < x) ++i;
+
+    if (i == this->n)
+    {
+        // append at the right end
+        while (i >= 2 && !isConvex(this->xs[i - 2], this->ys[i - 2], this->xs[i - 1], this->ys[i - 1], x, y))
+            --i;
+        this->xs[i] = x;
+        this->ys[i] = y;
+        this->ids[i] = id;
+        this->n = i + 1;
+        return true;
+    }
+
+    // out of order point
+    if (this->xs[i] == x) return false;
+    if (i > 0 && !isConvex(this->xs[i - 1], this->ys[i - 1], x, y, this->xs[i], this->ys[i])) return false;
+
+    for (uint32_t k = this->n; k > i; --k)
+    {
+        this->xs[k] = this->xs[k - 1];
+        this->ys[k] = this->ys[k - 1];
+        this->ids[k] = this->ids[k - 1];
+    }
+    this->xs[i] = x;
+    this->ys[i] = y;
+    this->ids[i] = id;
+    ++this->n;
+
+    while (i >= 2 && !isConvex(this->xs[i - 2], this->ys[i - 2], this->xs[i - 1], this->ys[i - 1], x, y))
+        this->erase(--i);
+    while (i + 2 < this->n && !isConvex(x, y, this->xs[i + 1], this->ys[i + 1], this->xs[i + 2], this->ys[i + 2]))
+        this->erase(i + 1);
+    return true;
+}
+
+template<typename TimeT, size_t N, bool Upper>
+uint32_t MiniSync::FixedHull<TimeT, N, Upper>::findTangent(point_t x, point_t y) const
+{
+    uint32_t count = 0;
+    while (count < this->n && this->xs[count] < x) ++count;
+    if (count == 0) return this->n;
+
+    uint32_t lo = 0;
+    uint32_t hi = count - 1;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        wide_t s_mid = static_cast<wide_t>(y - this->ys[mid]) * (x - this->xs[mid + 1]);
+        wide_t s_next = static_cast<wide_t>(y - this->ys[mid + 1]) * (x - this->xs[mid]);
+        if ((Upper && s_mid <= s_next) || (!Upper && s_mid >= s_next))
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
+
+template<typename TimeT, size_t N, bool Upper>
+void MiniSync::FixedHull<TimeT, N, Upper>::retain(PointId id1, PointId id2)
+{
+    uint32_t k = 0;
+    for (uint32_t i = 0; i < this->n; ++i)
+    {
+        if (this->ids[i] != id1 && this->ids[i] != id2) continue;
+        this->xs[k] = this->xs[i];
+        this->ys[k] = this->ys[i];
+        this->ids[k] = this->ids[i];
+        ++k;
+    }
+    this->n = k;
+}
+
+#endif //MINISYNCPP_HULL_H
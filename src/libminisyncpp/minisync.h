@@ -8,125 +8,120 @@
 #ifndef TINYSYNC___MINISYNC_H
 #define TINYSYNC___MINISYNC_H
 
-#include <tuple>
-#include <exception>
-#include <unordered_map>
-#include <set>
-#include <memory>
-#include "constraints.h"
+#include <chrono>
+#include "basic_sync.h"
 #include "minisync_api.h"
+#include "seqlock.h"
+#include "time_types.h"
 
 namespace MiniSync
 {
-    using LPointPtr = std::shared_ptr<LowPoint>;
-    using HPointPtr = std::shared_ptr<HighPoint>;
-    using ConstraintPtr = std::shared_ptr<ConstraintLine>;
-
-    // some hash specializations we'll need
-    struct ppair_hash
+    namespace Algorithms
     {
-        std::size_t operator()(const std::pair<std::shared_ptr<Point>, std::shared_ptr<Point>>& pair) const
+        /*
+         * Implementation of the API::Algorithm interface: a thin wrapper around BasicSync, which converts timestamps
+         * from µs into the representation given by TimeT and the estimates back.
+         */
+        template<typename RetentionPolicy, typename TimeT>
+        class Wrapper final : public MiniSync::API::Algorithm
         {
-            return std::hash<MiniSync::Point>()(*pair.first) ^ std::hash<MiniSync::Point>()(*pair.second);
-        }
-    };
+        public:
+            using Options = typename RetentionPolicy::Options;
 
-    // some comparison operations for sets of pointers to Points
-    struct lppoint_compare
-    {
-        bool operator()(const LPointPtr& lhs, const LPointPtr& rhs)
-        {
-            return *lhs < *rhs;
-        }
-    };
+            Wrapper() = default;
 
-    struct hppoint_compare
-    {
-        bool operator()(const HPointPtr& lhs, const HPointPtr& rhs)
-        {
-            return *lhs < *rhs;
-        }
-    };
+            explicit Wrapper(const Options& options) : sync(options)
+            {};
 
-    namespace Algorithms
-    {
-        class Base : public MiniSync::API::Algorithm
-        {
-        protected:
-            // constraints
-            std::unordered_map<std::pair<LPointPtr, HPointPtr>, ConstraintPtr, ppair_hash> low_constraints;
-            std::unordered_map<std::pair<LPointPtr, HPointPtr>, ConstraintPtr, ppair_hash> high_constraints;
-            std::set<LPointPtr, lppoint_compare> low_points;
-            std::set<HPointPtr, hppoint_compare> high_points;
-
-            ConstraintPtr current_high;
-            ConstraintPtr current_low;
-            std::pair<LPointPtr, HPointPtr> high_constraint_pts;
-            std::pair<LPointPtr, HPointPtr> low_constraint_pts;
-
-            struct
+            void addDataPoint(us_t To, us_t Tb, us_t Tr) override
+            {
+                this->sync.addDataPoint(TimeT::fromMicroseconds(To),
+                                        TimeT::fromMicroseconds(Tb),
+                                        TimeT::fromMicroseconds(Tr));
+                if (!this->sync.stale()) this->publish();
+            }
+
+            void addDataPoints(const API::DataPoint* points, size_t count) override;
+
+            long double getDrift() override
+            {
+                this->refresh();
+                return this->sync.getDrift();
+            }
+
+            long double getDriftError() override
             {
-                long double value = 1.0;
-                long double error = 0.0;
-            } currentDrift; // relative drift of the clock
+                this->refresh();
+                return this->sync.getDriftError();
+            }
 
-            struct
+            us_t getOffset() override
             {
-                us_t value{0};
-                us_t error{0};
-            } currentOffset; // current offset in µseconds
+                this->refresh();
+                return TimeT::toMicroseconds(this->sync.getOffset());
+            }
 
-            us_t diff_factor; // difference between current lines
-            uint32_t processed_timestamps;
+            us_t getOffsetError() override
+            {
+                this->refresh();
+                return TimeT::toMicroseconds(this->sync.getOffsetError());
+            }
 
-            Base();
+            void toReferenceTime(const int64_t* local, size_t count,
+                                 int64_t* reference, int64_t* lower, int64_t* upper) override;
 
-            void __recalculateEstimates();
+            std::vector<uint8_t> checkpoint() override
+            {
+                this->refresh();
+                std::vector<uint8_t> out;
+                this->sync.save(out);
+                return out;
+            }
 
-            /*
-             * Subclasses need to override this function with their own cleanup method.
-             */
+            void restore(const uint8_t* data, size_t size) override
+            {
+                this->sync.load(data, size);
+                this->publish();
+            }
 
-            virtual void cleanup() = 0;
+            API::Estimates getEstimates() override
+            { return this->published.read(); }
 
-            /*
-             * Helper instance method to add a lower-bound point to the algorithm.
-             */
-            virtual LPointPtr addLowPoint(us_t Tb, us_t To);
+            API::Metrics getMetrics() override
+            {
+                API::Metrics metrics = this->sync.getMetrics();
+                metrics.memory_bytes += this->batch.capacity() * sizeof(this->batch[0]);
+                return metrics;
+            }
 
-            /*
-            * Helper instance method to add a higher-bound point to the algorithm.
-            */
-            virtual HPointPtr addHighPoint(us_t Tb, us_t Tr);
-            virtual bool addConstraint(LPointPtr lp, HPointPtr hp);
-        public:
-            void addDataPoint(us_t To, us_t Tb, us_t Tr) final;
-            long double getDrift() final;
-            long double getDriftError() final;
-            us_t getOffset() final;
-            us_t getOffsetError() final;
-            std::chrono::time_point<std::chrono::system_clock, us_t> getCurrentAdjustedTime() final;
-        };
+            std::chrono::time_point<std::chrono::system_clock, us_t> getCurrentAdjustedTime() override;
 
-        class TinySync : public Base
-        {
-        public:
-            TinySync() = default;
         private:
-            void cleanup() final;
-        };
+            BasicSync<RetentionPolicy, TimeT> sync;
+            std::vector<typename BasicSync<RetentionPolicy, TimeT>::Sample> batch; // reused for conversions
+            SeqLock<API::Estimates> published; // estimates for concurrent readers
 
-        class MiniSync : public Base
-        {
-        public:
-            MiniSync() = default;
-        private:
-            std::unordered_map<std::pair<LPointPtr, LPointPtr>, long double, ppair_hash> low_slopes;
-            std::unordered_map<std::pair<HPointPtr, HPointPtr>, long double, ppair_hash> high_slopes;
-            void cleanup() final;
-            LPointPtr addLowPoint(us_t Tb, us_t To) final;
-            HPointPtr addHighPoint(us_t Tb, us_t Tr) final;
+            void publish();
+
+            // in lazy mode, processes the queued data points and publishes the new estimates
+            void refresh()
+            {
+                if (!this->sync.stale()) return;
+                this->sync.refresh();
+                this->publish();
+            }
         };
+
+        template<typename TimeT>
+        using TinySync = Wrapper<Retention::TinySync, TimeT>;
+
+        template<typename TimeT>
+        using MiniSync = Wrapper<Retention::MiniSync, TimeT>;
+
+        extern template class Wrapper<Retention::TinySync, Time::LongDoubleMicroseconds>;
+        extern template class Wrapper<Retention::TinySync, Time::Int64Nanoseconds>;
+        extern template class Wrapper<Retention::MiniSync, Time::LongDoubleMicroseconds>;
+        extern template class Wrapper<Retention::MiniSync, Time::Int64Nanoseconds>;
     }
 }
 
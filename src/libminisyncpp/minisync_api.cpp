@@ -11,10 +11,32 @@
 
 std::shared_ptr<MiniSync::API::Algorithm> MiniSync::API::Factory::createTinySync()
 {
-    return std::shared_ptr<MiniSync::API::Algorithm>(new MiniSync::Algorithms::TinySync());
+    return std::shared_ptr<MiniSync::API::Algorithm>(
+        new MiniSync::Algorithms::TinySync<MiniSync::Time::LongDoubleMicroseconds>());
+}
+
+std::shared_ptr<MiniSync::API::Algorithm>
+MiniSync::API::Factory::createTinySync(const MiniSync::API::Factory::TinySyncOptions& options)
+{
+    if (options.time == TimeRepresentation::INT64_NANOSECONDS)
+        return std::shared_ptr<MiniSync::API::Algorithm>(
+            new MiniSync::Algorithms::TinySync<MiniSync::Time::Int64Nanoseconds>(options));
+    return std::shared_ptr<MiniSync::API::Algorithm>(
+        new MiniSync::Algorithms::TinySync<MiniSync::Time::LongDoubleMicroseconds>(options));
 }
 
 std::shared_ptr<MiniSync::API::Algorithm> MiniSync::API::Factory::createMiniSync()
 {
-    return std::shared_ptr<MiniSync::API::Algorithm>(new MiniSync::Algorithms::MiniSync());
+    return std::shared_ptr<MiniSync::API::Algorithm>(
+        new MiniSync::Algorithms::MiniSync<MiniSync::Time::LongDoubleMicroseconds>());
+}
+
+std::shared_ptr<MiniSync::API::Algorithm>
+MiniSync::API::Factory::createMiniSync(const MiniSync::API::Factory::MiniSyncOptions& options)
+{
+    if (options.time == TimeRepresentation::INT64_NANOSECONDS)
+        return std::shared_ptr<MiniSync::API::Algorithm>(
+            new MiniSync::Algorithms::MiniSync<MiniSync::Time::Int64Nanoseconds>(options));
+    return std::shared_ptr<MiniSync::API::Algorithm>(
+        new MiniSync::Algorithms::MiniSync<MiniSync::Time::LongDoubleMicroseconds>(options));
 }
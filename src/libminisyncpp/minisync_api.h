@@ -8,7 +8,10 @@
 #define MINISYNCPP_MINISYNC_API_H
 
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 namespace MiniSync
 {
@@ -16,6 +19,63 @@ namespace MiniSync
 
     namespace API
     {
+        /*
+         * Timestamps of a single beacon exchange: local send time, reference time and local receive time.
+         */
+        struct DataPoint
+        {
+            us_t To;
+            us_t Tb;
+            us_t Tr;
+        };
+
+        /*
+         * A consistent set of estimates, all from the same update.
+         */
+        struct Estimates
+        {
+            long double drift = 1.0;
+            long double drift_error = 0.0;
+            us_t offset{0};
+            us_t offset_error{0};
+        };
+
+        /*
+         * Reference time corresponding to local time t, i.e. the inverse of local = drift * reference + offset.
+         */
+        inline us_t toReference(const Estimates& estimates, us_t t)
+        {
+            return (t - estimates.offset) / estimates.drift;
+        }
+
+        /*
+         * Internal counters of an algorithm, for monitoring.
+         *
+         * The sizes are always available. The hot path counters (pairs_evaluated, constraint_resets and the times) are
+         * only updated if the library was built with LIBMINISYNCPP_ENABLE_METRICS, as indicated by instrumented, and
+         * are zero otherwise.
+         */
+        struct Metrics
+        {
+            bool instrumented = false;
+            uint64_t samples = 0;           // data points added, including the ones still queued in lazy mode
+            size_t pending = 0;             // data points queued in lazy mode
+            size_t low_points = 0;          // stored (Tb, To) points
+            size_t high_points = 0;         // stored (Tb, Tr) points
+            size_t constraints = 0;         // current constraint lines, 0 or 2
+            size_t memory_bytes = 0;        // heap memory held for stored and queued points
+            uint64_t pairs_evaluated = 0;   // candidate pairs of constraint lines compared
+            uint64_t constraint_resets = 0; // searches for the constraints among all stored points
+            uint64_t update_ns = 0;         // total time spent processing data points and updating the estimates
+            uint64_t cleanup_ns = 0;        // part of update_ns spent discarding points
+        };
+
+        /*
+         * Data points must only be added from one thread at a time, and the getters returning a single estimate must
+         * be called from that same thread. getEstimates() and getCurrentAdjustedTime() on the other hand can be called
+         * from any number of threads, concurrently with each other and with the thread adding data points: they read
+         * the latest published estimates without locking, and never block the thread updating them.
+         */
         class Algorithm
         {
         public:
@@ -24,6 +84,11 @@ namespace MiniSync
              */
             virtual void addDataPoint(us_t To, us_t Tb, us_t Tr) = 0;
 
+            /*
+             * Add count DataPoints (in time order) and recalculate offset and drift only once, after all of them.
+             */
+            virtual void addDataPoints(const DataPoint* points, size_t count) = 0;
+
             /*
              * Get the current estimated relative clock drift.
              */
@@ -37,15 +102,106 @@ namespace MiniSync
             virtual us_t getOffsetError() = 0;
 
             /*
-             * Get the current adjusted time
+             * Translate count local timestamps into the time base of the reference, using the current estimates, and
+             * get the lower and upper bounds for each given by the current constraint lines.
+             * Timestamps are in integer ns relative to the origin of the local timestamps given to the algorithm (To
+             * and Tr), and are translated relative to the origin of the reference timestamps (Tb). Throws if there
+             * are no estimates yet.
+             */
+            virtual void toReferenceTime(const int64_t* local, size_t count,
+                                         int64_t* reference, int64_t* lower, int64_t* upper) = 0;
+
+            /*
+             * Serialize the state of the algorithm (stored points, current constraints, estimates and counters) into a
+             * compact versioned binary checkpoint, from which restore() resumes with exactly the same estimates, e.g.
+             * after a restart. Only meaningful if the timestamps given before and after keep the same origins.
+             */
+            virtual std::vector<uint8_t> checkpoint() = 0;
+
+            /*
+             * Replace the state of the algorithm with a checkpoint, in time linear in the number of stored points.
+             * Throws std::invalid_argument if the checkpoint is corrupt, was written by an incompatible version, or
+             * comes from a different algorithm, time representation or window setting.
+             */
+            virtual void restore(const uint8_t* data, size_t size) = 0;
+
+            /*
+             * Get the latest published estimates. Thread safe.
+             */
+            virtual Estimates getEstimates() = 0;
+
+            /*
+             * Get the internal counters of the algorithm. Like the other getters, only from the thread adding data
+             * points. Doesn't process queued data points in lazy mode.
+             */
+            virtual Metrics getMetrics() = 0;
+
+            /*
+             * Get the current time of the reference clock, converting system_clock::now() with the latest published
+             * estimates. Thread safe.
+             *
+             * This assumes the local timestamps (To and Tr) are times since the epoch of system_clock, and returns the
+             * reference time relative to the origin of its timestamps (Tb). For any other local clock base, e.g.
+             * steady_clock since some start, use an AdjustedClock, which is also faster.
              */
             virtual std::chrono::time_point<std::chrono::system_clock, us_t> getCurrentAdjustedTime() = 0;
         };
 
         namespace Factory
         {
+            /*
+             * Representation of timestamps and estimates used internally by the algorithms. The API always works in
+             * µs, timestamps are converted when added and estimates when read.
+             */
+            enum class TimeRepresentation
+            {
+                // µs in long double (default)
+                LONG_DOUBLE_MICROSECONDS,
+                // integer ns, with double precision slopes and intercepts: faster where long double arithmetic is
+                // slow, but timestamps should be relative to a recent origin to keep the offset precise
+                INT64_NANOSECONDS
+            };
+
+            /*
+             * Optional settings for TinySync.
+             *
+             * In lazy mode, adding a data point only queues it, and the estimates are brought up to date the next time
+             * they are read. The results are exactly the same as in the default (eager) mode, which makes this a good
+             * fit when data points arrive much more often than the estimates are needed. Note that errors caused by
+             * invalid data points are then also only reported when reading the estimates.
+             *
+             * The estimates returned by the thread safe getEstimates() and getCurrentAdjustedTime() are only published
+             * when they are brought up to date, i.e. when one of the other getters is called.
+             */
+            struct TinySyncOptions
+            {
+                bool lazy = false;
+                TimeRepresentation time = TimeRepresentation::LONG_DOUBLE_MICROSECONDS;
+            };
+
+            /*
+             * Optional settings for MiniSync.
+             *
+             * By default MiniSync keeps every point which can still tighten the bounds. Setting a window makes it
+             * forget points (and the constraints built on them) once they are older than the window, which puts a
+             * hard bound on memory use and per-sample cost and lets the estimates follow slow changes in the drift.
+             * Both limits can be combined; a value of 0 disables the corresponding limit.
+             */
+            struct MiniSyncOptions
+            {
+                // only keep points from the latest window_samples samples (must be at least 2)
+                uint32_t window_samples = 0;
+                // only keep points with Tb within window_span of the latest Tb
+                us_t window_span{0};
+                // see TinySyncOptions
+                bool lazy = false;
+                TimeRepresentation time = TimeRepresentation::LONG_DOUBLE_MICROSECONDS;
+            };
+
             std::shared_ptr<MiniSync::API::Algorithm> createTinySync();
+            std::shared_ptr<MiniSync::API::Algorithm> createTinySync(const TinySyncOptions& options);
             std::shared_ptr<MiniSync::API::Algorithm> createMiniSync();
+            std::shared_ptr<MiniSync::API::Algorithm> createMiniSync(const MiniSyncOptions& options);
         }
     }
 }
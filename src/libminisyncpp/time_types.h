@@ -0,0 +1,94 @@
+/*
+* Author: Manuel Olguín Muñoz <manuel@olguin.se>
+*
+* Copyright© 2019 Manuel Olguín Muñoz
+* See LICENSE file included in the root directory of this project for licensing and copyright details.
+*/
+
+#ifndef MINISYNCPP_TIME_TYPES_H
+#define MINISYNCPP_TIME_TYPES_H
+
+#include <cmath>
+#include <cstdint>
+#include "minisync_api.h"
+
+namespace MiniSync
+{
+    /*
+     * Representations of time used internally by the algorithms.
+     *
+     * Each representation defines
+     *  - point_t: type of the stored timestamps (the x and y coordinates of the points),
+     *  - real_t: type of the slopes and intercepts of the constraint lines, and of the estimates,
+     *  - wide_t: type used to multiply two differences of timestamps in the geometric predicates of the hulls,
+     * together with conversions from and to the microseconds used by the public API.
+     */
+    namespace Time
+    {
+        /*
+         * Timestamps in µs, with everything computed in long double. This is the original representation.
+         */
+        struct LongDoubleMicroseconds
+        {
+            using point_t = long double;
+            using real_t = long double;
+            using wide_t = long double;
+
+            static point_t fromMicroseconds(us_t t)
+            { return t.count(); }
+
+            static us_t toMicroseconds(real_t t)
+            { return us_t{t}; }
+
+            // identifies the representation in checkpoints
+            static uint8_t checkpointId()
+            { return 1; }
+        };
+
+        /*
+         * Timestamps in integer ns, with slopes and intercepts in double. Avoids long double arithmetic, which goes
+         * through the x87 unit on x86 and is emulated in software on some targets.
+         *
+         * Error analysis, with u = 2^-53 the unit roundoff of double and timestamps |t| < 2^62 ns:
+         *
+         *  - Timestamps and their differences are exact. Differences below 2^53 ns (~104 days) also convert exactly
+         *    to double.
+         *  - The hull predicates multiply two differences. With 128-bit integers these products, and therefore the
+         *    shape of the hulls, are exact. Without them (e.g. on 32-bit ARM) the products are rounded to double, so a
+         *    point within a relative distance of ~2u of the line through its neighbours may be kept or dropped when it
+         *    shouldn't. Either way the lines found differ from the exact ones by a relative ~2u in slope.
+         *  - A slope A = dy/dx is computed from exact differences, so its relative error is at most u (3u for
+         *    differences above 2^53 ns), i.e. ~1e-16 for A ~ 1. The bounds themselves are at least d/T wide for a
+         *    minimum delay d over a span T, e.g. 1 µs over a day is ~1e-11, so rounding stays orders of magnitude
+         *    below the estimated drift error.
+         *  - An intercept B = y - A*x has an absolute error of about u*(|y| + 2|A*x|), i.e. it grows with the
+         *    magnitude of the timestamps rather than with the differences between them: ~0.3 ns for timestamps
+         *    a week away from zero, but ~1 µs for timestamps counted from the UNIX epoch. Timestamps should therefore
+         *    be relative to a recent origin (the demo node uses the time at which it started).
+         *  - Drift and offset are the midpoints and half-widths of the slopes and intercepts, adding one more rounding.
+         *
+         * Conversions from µs round to the nearest ns.
+         */
+        struct Int64Nanoseconds
+        {
+            using point_t = int64_t;
+            using real_t = double;
+#ifdef __SIZEOF_INT128__
+            __extension__ typedef __int128 wide_t;
+#else
+            using wide_t = double;
+#endif
+
+            static point_t fromMicroseconds(us_t t)
+            { return std::llround(t.count() * 1000); }
+
+            static us_t toMicroseconds(real_t t)
+            { return us_t{static_cast<long double>(t) / 1000}; }
+
+            static uint8_t checkpointId()
+            { return 2; }
+        };
+    }
+}
+
+#endif //MINISYNCPP_TIME_TYPES_H
@@ -0,0 +1,250 @@
+/*
+* Author: Manuel Olguín Muñoz <manuel@olguin.se>
+*
+* Copyright© 2019 Manuel Olguín Muñoz
+* See LICENSE file included in the root directory of this project for licensing and copyright details.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "translate.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define MINISYNCPP_TRANSLATE_AVX2
+
+#include <immintrin.h>
+
+#elif defined(__aarch64__) && defined(__ARM_NEON) && defined(LIBMINISYNCPP_NEON_ENABLE)
+// opt-in until the kernel has been tested on AArch64, see LIBMINISYNCPP_ENABLE_NEON
+#define MINISYNCPP_TRANSLATE_NEON
+
+#include <arm_neon.h>
+
+#endif
+
+/*
+ * Each line is inverted into
+ *
+ *     reference = (local - B) / A = d + (d * k + e)
+ *
+ * with d = local - b, b = B rounded to an integer, k = 1 / A - 1 and e = (b - B) / A. The subtraction is exact, and
+ * the correction d * k + e is small compared to d (for |k| < 1), so computing it in double and rounding it to the
+ * nearest ns keeps the result within ~0.5 ns of the exact one.
+ *
+ * The kernels only handle lines with A > 0.5 (i.e. |k| < 1). Anything else only shows up with degenerate estimates
+ * (e.g. constraint lines with a negative slope right after the first samples), which go through a slower long double
+ * path, where a constraint line with A <= 0 leaves the corresponding bounds open.
+ */
+
+namespace
+{
+    using namespace MiniSync::Translate;
+
+    struct Inverse
+    {
+        int64_t b;
+        double k;
+        double e;
+    };
+
+    bool invertible(const Line& line)
+    {
+        return line.A > 0.5;
+    }
+
+    Inverse invert(const Line& line)
+    {
+        Inverse inv;
+        inv.b = std::llround(line.B);
+        inv.k = static_cast<double>(1 / line.A - 1);
+        inv.e = static_cast<double>((inv.b - line.B) / line.A);
+        return inv;
+    }
+
+    inline int64_t apply(const Inverse& inv, int64_t t)
+    {
+        const int64_t d = t - inv.b;
+        const double c = static_cast<double>(d) * inv.k + inv.e;
+        return d + static_cast<int64_t>(std::nearbyint(c));
+    }
+
+    void translateInverses(const Inverse& estimate, const Inverse& low, const Inverse& high,
+                           const int64_t* local, size_t begin, size_t end,
+                           int64_t* reference, int64_t* lower, int64_t* upper)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            reference[i] = apply(estimate, local[i]);
+            const int64_t r_low = apply(low, local[i]);
+            const int64_t r_high = apply(high, local[i]);
+            lower[i] = std::min(r_low, r_high);
+            upper[i] = std::max(r_low, r_high);
+        }
+    }
+
+    int64_t saturate(long double t)
+    {
+        if (!(t > static_cast<long double>(std::numeric_limits<int64_t>::min())))
+            return std::numeric_limits<int64_t>::min();
+        if (t >= static_cast<long double>(std::numeric_limits<int64_t>::max()))
+            return std::numeric_limits<int64_t>::max();
+        return std::llround(t);
+    }
+
+    // slow path for degenerate lines
+    void translateDegenerate(const Line& estimate, const Line& low, const Line& high,
+                             const int64_t* local, size_t count,
+                             int64_t* reference, int64_t* lower, int64_t* upper)
+    {
+        const bool bounded = low.A > 0 && high.A > 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const long double t = local[i];
+            reference[i] = saturate((t - estimate.B) / estimate.A);
+            if (bounded)
+            {
+                const long double r_low = (t - low.B) / low.A;
+                const long double r_high = (t - high.B) / high.A;
+                lower[i] = saturate(std::min(r_low, r_high));
+                upper[i] = saturate(std::max(r_low, r_high));
+            }
+            else
+            {
+                lower[i] = std::numeric_limits<int64_t>::min();
+                upper[i] = std::numeric_limits<int64_t>::max();
+            }
+        }
+    }
+
+#ifdef MINISYNCPP_TRANSLATE_AVX2
+
+    /*
+     * Four timestamps at a time. AVX2 has no conversions between int64 and double, so they go through the usual
+     * 2^52 + 2^51 bias, which is exact for |x| < 2^51. Blocks with a larger d (over ~13 days away from the offset)
+     * are left to the scalar code.
+     */
+    struct Avx2Inverse
+    {
+        __m256i b;
+        __m256d k;
+        __m256d e;
+    };
+
+    __attribute__((target("avx2")))
+    inline __m256i applyAvx2(const Avx2Inverse& inv, __m256i t, __m256i& out_of_range)
+    {
+        const __m256d bias = _mm256_set1_pd(6755399441055744.0); // 2^52 + 2^51
+        const __m256i bias_i = _mm256_castpd_si256(bias);
+        const __m256i limit = _mm256_set1_epi64x(int64_t{1} << 50);
+
+        const __m256i d = _mm256_sub_epi64(t, inv.b);
+        out_of_range = _mm256_or_si256(out_of_range,
+                                       _mm256_or_si256(_mm256_cmpgt_epi64(d, limit),
+                                                       _mm256_cmpgt_epi64(_mm256_sub_epi64(_mm256_setzero_si256(),
+                                                                                           limit), d)));
+
+        const __m256d dd = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(d, bias_i)), bias);
+        const __m256d c = _mm256_add_pd(_mm256_mul_pd(dd, inv.k), inv.e);
+        // adding the bias rounds to the nearest integer
+        const __m256i ci = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(c, bias)), bias_i);
+        return _mm256_add_epi64(d, ci);
+    }
+
+    __attribute__((target("avx2")))
+    void translateAvx2(const Inverse& estimate, const Inverse& low, const Inverse& high,
+                       const int64_t* local, size_t count,
+                       int64_t* reference, int64_t* lower, int64_t* upper)
+    {
+        const Avx2Inverse inv[3] = {
+            {_mm256_set1_epi64x(estimate.b), _mm256_set1_pd(estimate.k), _mm256_set1_pd(estimate.e)},
+            {_mm256_set1_epi64x(low.b), _mm256_set1_pd(low.k), _mm256_set1_pd(low.e)},
+            {_mm256_set1_epi64x(high.b), _mm256_set1_pd(high.k), _mm256_set1_pd(high.e)}};
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m256i t = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(local + i));
+            __m256i out_of_range = _mm256_setzero_si256();
+            const __m256i r = applyAvx2(inv[0], t, out_of_range);
+            const __m256i r_low = applyAvx2(inv[1], t, out_of_range);
+            const __m256i r_high = applyAvx2(inv[2], t, out_of_range);
+            if (!_mm256_testz_si256(out_of_range, out_of_range))
+            {
+                translateInverses(estimate, low, high, local, i, i + 4, reference, lower, upper);
+                continue;
+            }
+
+            const __m256i low_gt_high = _mm256_cmpgt_epi64(r_low, r_high);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(reference + i), r);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(lower + i),
+                                _mm256_blendv_epi8(r_low, r_high, low_gt_high));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(upper + i),
+                                _mm256_blendv_epi8(r_high, r_low, low_gt_high));
+        }
+        translateInverses(estimate, low, high, local, i, count, reference, lower, upper);
+    }
+
+#endif
+
+#ifdef MINISYNCPP_TRANSLATE_NEON
+
+    /*
+     * Two timestamps at a time. AArch64 converts between int64 and double directly, rounding to nearest like the
+     * scalar code.
+     */
+    inline int64x2_t applyNeon(const Inverse& inv, int64x2_t t)
+    {
+        const int64x2_t d = vsubq_s64(t, vdupq_n_s64(inv.b));
+        const float64x2_t c = vaddq_f64(vmulq_f64(vcvtq_f64_s64(d), vdupq_n_f64(inv.k)), vdupq_n_f64(inv.e));
+        return vaddq_s64(d, vcvtnq_s64_f64(c));
+    }
+
+    void translateNeon(const Inverse& estimate, const Inverse& low, const Inverse& high,
+                       const int64_t* local, size_t count,
+                       int64_t* reference, int64_t* lower, int64_t* upper)
+    {
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            const int64x2_t t = vld1q_s64(local + i);
+            const int64x2_t r_low = applyNeon(low, t);
+            const int64x2_t r_high = applyNeon(high, t);
+            const uint64x2_t low_gt_high = vcgtq_s64(r_low, r_high);
+            vst1q_s64(reference + i, applyNeon(estimate, t));
+            vst1q_s64(lower + i, vbslq_s64(low_gt_high, r_high, r_low));
+            vst1q_s64(upper + i, vbslq_s64(low_gt_high, r_low, r_high));
+        }
+        translateInverses(estimate, low, high, local, i, count, reference, lower, upper);
+    }
+
+#endif
+}
+
+void MiniSync::Translate::translate(const Line& estimate, const Line& low, const Line& high,
+                                    const int64_t* local, size_t count,
+                                    int64_t* reference, int64_t* lower, int64_t* upper)
+{
+    if (!invertible(estimate) || !invertible(low) || !invertible(high))
+        return translateDegenerate(estimate, low, high, local, count, reference, lower, upper);
+
+#if defined(MINISYNCPP_TRANSLATE_AVX2)
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    if (has_avx2)
+        return translateAvx2(invert(estimate), invert(low), invert(high), local, count, reference, lower, upper);
+#elif defined(MINISYNCPP_TRANSLATE_NEON)
+    return translateNeon(invert(estimate), invert(low), invert(high), local, count, reference, lower, upper);
+#endif
+
+    translateInverses(invert(estimate), invert(low), invert(high), local, 0, count, reference, lower, upper);
+}
+
+void MiniSync::Translate::translateScalar(const Line& estimate, const Line& low, const Line& high,
+                                          const int64_t* local, size_t count,
+                                          int64_t* reference, int64_t* lower, int64_t* upper)
+{
+    if (!invertible(estimate) || !invertible(low) || !invertible(high))
+        return translateDegenerate(estimate, low, high, local, count, reference, lower, upper);
+
+    translateInverses(invert(estimate), invert(low), invert(high), local, 0, count, reference, lower, upper);
+}
@@ -0,0 +1,48 @@
+/*
+* Author: Manuel Olguín Muñoz <manuel@olguin.se>
+*
+* Copyright© 2019 Manuel Olguín Muñoz
+* See LICENSE file included in the root directory of this project for licensing and copyright details.
+*/
+
+#ifndef MINISYNCPP_TRANSLATE_H
+#define MINISYNCPP_TRANSLATE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace MiniSync
+{
+    /*
+     * Bulk translation of local timestamps into the reference time base, used by
+     * API::Algorithm::toReferenceTime().
+     */
+    namespace Translate
+    {
+        // line relating both clocks as local = A * reference + B, with B in ns
+        struct Line
+        {
+            long double A;
+            long double B;
+        };
+
+        /*
+         * Translates count local timestamps (in ns) through the estimate line, and through both constraint lines for
+         * the lower and upper bounds. Uses AVX2 kernels where available, and NEON kernels
+         * if enabled with LIBMINISYNCPP_ENABLE_NEON.
+         */
+        void translate(const Line& estimate, const Line& low, const Line& high,
+                       const int64_t* local, size_t count,
+                       int64_t* reference, int64_t* lower, int64_t* upper);
+
+        /*
+         * Same as translate(), without the SIMD kernels. These give the same results, except maybe for the rounding
+         * of the last ns where the compiler fuses the multiply-add in one of them.
+         */
+        void translateScalar(const Line& estimate, const Line& low, const Line& high,
+                             const int64_t* local, size_t count,
+                             int64_t* reference, int64_t* lower, int64_t* upper);
+    }
+}
+
+#endif //MINISYNCPP_TRANSLATE_H
@@ -0,0 +1,95 @@
+/*
+* Author: Manuel Olguín Muñoz <manuel@olguin.se>
+*
+* Copyright© 2019 Manuel Olguín Muñoz
+* See LICENSE file included in the root directory of this project for licensing and copyright details.
+*/
+
+#include <cmath>
+#include "workload.h"
+
+MiniSync::Workload::Generator::Generator(uint64_t seed, const Options& options) :
+        options(options),
+        gen(seed),
+        local(options.offset),
+        drift(1 + options.skew)
+{}
+
+/*
+ * The 53 high bits of the next number, as a multiple of 2^-53.
+ */
+double MiniSync::Workload::Generator::uniform()
+{
+    return static_cast<double>(this->gen() >> 11u) * (1.0 / 9007199254740992.0);
+}
+
+// inverse transform sampling
+double MiniSync::Workload::Generator::exponential()
+{
+    return -std::log(1.0 - this->uniform());
+}
+
+// Box-Muller transform, using only the cosine
+double MiniSync::Workload::Generator::normal()
+{
+    const double u1 = 1.0 - this->uniform(); // (0, 1]
+    const double u2 = this->uniform();
+    const double two_pi = 6.283185307179586;
+    return std::sqrt(-2.0 * std::log(u1)) * std::cos(two_pi * u2);
+}
+
+long double MiniSync::Workload::Generator::delay(const DelayOptions& delay_options)
+{
+    long double d = delay_options.minimum;
+    if (delay_options.mean_jitter > 0)
+        d += delay_options.mean_jitter * this->exponential();
+    if (delay_options.tail_probability > 0 && this->uniform() < delay_options.tail_probability)
+    {
+        // inverse transform sampling of a Pareto distribution, shifted to start at 0
+        const double u = 1.0 - this->uniform(); // (0, 1]
+        d += delay_options.tail_scale * (std::pow(u, -1.0 / delay_options.tail_shape) - 1.0);
+    }
+    return d;
+}
+
+void MiniSync::Workload::Generator::advance()
+{
+    this->reference += this->options.interval;
+    this->local += this->drift * this->options.interval;
+
+    if (this->options.skew_wander > 0)
+        this->drift += this->options.skew_wander * this->normal();
+    if (this->options.step_probability > 0 && this->uniform() < this->options.step_probability)
+        this->local += this->options.step_size * (2 * this->uniform() - 1);
+}
+
+MiniSync::Workload::Sample MiniSync::Workload::Generator::next()
+{
+    for (;;)
+    {
+        this->advance();
+        if (this->options.loss_probability > 0 && this->uniform() < this->options.loss_probability)
+        {
+            ++this->lost_count;
+            continue;
+        }
+
+        // the reference timestamps the beacon at the current time, both delays are measured by the local clock
+        const long double forward = this->delay(this->options.forward);
+        const long double backward = this->delay(this->options.backward);
+
+        Sample sample{};
+        sample.point.To = us_t{this->local - this->drift * forward};
+        sample.point.Tb = us_t{this->reference};
+        sample.point.Tr = us_t{this->local + this->drift * backward};
+        sample.drift = this->drift;
+        sample.offset = us_t{this->local - this->drift * this->reference};
+        return sample;
+    }
+}
+
+void MiniSync::Workload::Generator::fill(API::DataPoint* out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        out[i] = this->next().point;
+}
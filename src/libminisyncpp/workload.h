@@ -0,0 +1,112 @@
+/*
+* Author: Manuel Olguín Muñoz <manuel@olguin.se>
+*
+* Copyright© 2019 Manuel Olguín Muñoz
+* See LICENSE file included in the root directory of this project for licensing and copyright details.
+*/
+
+#ifndef MINISYNCPP_WORKLOAD_H
+#define MINISYNCPP_WORKLOAD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include "minisync_api.h"
+
+namespace MiniSync
+{
+    /*
+     * Deterministic synthetic workloads, for tests and benchmarks.
+     *
+     * Simulates a local clock running against a reference clock, and the beacon exchanges between them. The local
+     * clock advances at the current drift (1 + skew) times the rate of the reference, where the skew can follow a
+     * random walk and the local clock can be stepped by random amounts. Each exchange is timestamped by the local
+     * clock when the beacon is sent (To) and when the reply arrives (Tr), and by the reference clock in between (Tb),
+     * with independent delay distributions on the way there and back. Exchanges can be lost.
+     *
+     * For a given seed and options, the sequence of samples is always the same, on any standard library: the random
+     * numbers come straight from std::mt19937_64 (whose output the standard fully specifies), and are shaped by the
+     * generator itself instead of the standard distributions, whose algorithms are implementation-defined. Only
+     * differences in the rounding of std::log, std::pow and the like can make them differ, in the last bits.
+     */
+    namespace Workload
+    {
+        /*
+         * Distribution of the one-way delay of the beacons, in µs: a fixed minimum, plus exponentially distributed
+         * jitter, plus (with probability tail_probability) a Pareto distributed excursion with the given scale and
+         * shape, for heavy-tailed queueing delays. A shape <= 2 gives an infinite variance.
+         */
+        struct DelayOptions
+        {
+            long double minimum = 50;
+            long double mean_jitter = 200;
+            double tail_probability = 0;
+            long double tail_scale = 1000;
+            double tail_shape = 1.5;
+        };
+
+        struct Options
+        {
+            long double interval = 100000; // µs of reference time between exchanges
+            long double skew = 37e-6;      // initial drift - 1
+            long double skew_wander = 0;   // standard deviation of the skew random walk, per exchange
+            long double offset = 12345;    // µs, initial offset of the local clock
+            double step_probability = 0;   // probability of an offset step before each exchange
+            long double step_size = 1000;  // µs, steps are uniformly distributed in [-step_size, step_size]
+            double loss_probability = 0;   // probability of an exchange being lost
+            DelayOptions forward;          // local to reference
+            DelayOptions backward;         // reference to local
+        };
+
+        /*
+         * A simulated exchange, with the true relation between both clocks at the reference time Tb, such that
+         * local ~= drift * reference + offset around Tb.
+         */
+        struct Sample
+        {
+            API::DataPoint point;
+            long double drift;
+            us_t offset;
+        };
+
+        class Generator
+        {
+        public:
+            explicit Generator(uint64_t seed, const Options& options = Options());
+
+            /*
+             * Simulates exchanges until one is not lost, and returns it.
+             */
+            Sample next();
+
+            /*
+             * Writes the next count data points to out, without the ground truth.
+             */
+            void fill(API::DataPoint* out, size_t count);
+
+            /*
+             * Number of exchanges lost so far.
+             */
+            uint64_t lost() const
+            { return this->lost_count; }
+
+        private:
+            long double delay(const DelayOptions& options);
+            void advance();
+
+            double uniform();     // [0, 1)
+            double exponential(); // mean 1
+            double normal();      // mean 0, standard deviation 1
+
+            Options options;
+            std::mt19937_64 gen;
+
+            long double reference = 0; // µs
+            long double local;         // µs
+            long double drift;
+            uint64_t lost_count = 0;
+        };
+    }
+}
+
+#endif //MINISYNCPP_WORKLOAD_H
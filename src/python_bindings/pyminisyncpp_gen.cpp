@@ -9,7 +9,13 @@
 #define LIBMINISYNCPP_PYMINISYNCPP_GEN_CPP
 
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
 #include <minisync_api.h>
+#include <tuple>
+#include <vector>
+
+// (To, Tb, Tr)
+using DataPoint = std::tuple<long double, long double, long double>;
 
 class Algorithm
 {
@@ -27,6 +33,17 @@ public:
             MiniSync::us_t{Tr});
     }
 
+    virtual void addDataPoints(const std::vector<DataPoint>& points)
+    {
+        std::vector<MiniSync::API::DataPoint> batch;
+        batch.reserve(points.size());
+        for (const auto& p: points)
+            batch.push_back({MiniSync::us_t{std::get<0>(p)},
+                             MiniSync::us_t{std::get<1>(p)},
+                             MiniSync::us_t{std::get<2>(p)}});
+        algo->addDataPoints(batch.data(), batch.size());
+    }
+
     virtual long double getDrift()
     {
         return algo->getDrift();
@@ -46,6 +63,11 @@ public:
     {
         return algo->getOffsetError().count();
     }
+
+    virtual MiniSync::API::Metrics getMetrics()
+    {
+        return algo->getMetrics();
+    }
 };
 
 class MiniSyncAlgorithm : public Algorithm
@@ -81,6 +103,11 @@ public:
         PYBIND11_OVERLOAD(void, AlgorithmBase, addDataPoint, To, Tb, Tr);
     }
 
+    void addDataPoints(const std::vector<DataPoint>& points) override
+    {
+        PYBIND11_OVERLOAD(void, AlgorithmBase, addDataPoints, points);
+    }
+
     long double getDrift() override
     {
         PYBIND11_OVERLOAD(long double, AlgorithmBase, getDrift,);
@@ -101,6 +128,11 @@ public:
         PYBIND11_OVERLOAD(long double, AlgorithmBase, getOffsetError,);
     }
 
+    MiniSync::API::Metrics getMetrics() override
+    {
+        PYBIND11_OVERLOAD(MiniSync::API::Metrics, AlgorithmBase, getMetrics,);
+    }
+
 };
 
 // Python bindings:
@@ -110,34 +142,54 @@ PYBIND11_MODULE(pyminisyncpp, m)
     // documentation
     m.doc() = "PyMiniSynCPP: Python bindings for the libminisyncpp C++ library.\n";
 
+    py::class_<MiniSync::API::Metrics> pyMetrics(m, "Metrics");
     py::class_<Algorithm, PyAlgorithm<>> pyAlgo(m, "Algorithm");
     py::class_<TinySyncAlgorithm, PyAlgorithm<TinySyncAlgorithm>> pyTiny(m, "TinySyncAlgorithm");
     py::class_<MiniSyncAlgorithm, PyAlgorithm<MiniSyncAlgorithm>> pyMini(m, "MiniSyncAlgorithm");
 
+    pyMetrics
+        .def_readonly("instrumented", &MiniSync::API::Metrics::instrumented)
+        .def_readonly("samples", &MiniSync::API::Metrics::samples)
+        .def_readonly("pending", &MiniSync::API::Metrics::pending)
+        .def_readonly("low_points", &MiniSync::API::Metrics::low_points)
+        .def_readonly("high_points", &MiniSync::API::Metrics::high_points)
+        .def_readonly("constraints", &MiniSync::API::Metrics::constraints)
+        .def_readonly("memory_bytes", &MiniSync::API::Metrics::memory_bytes)
+        .def_readonly("pairs_evaluated", &MiniSync::API::Metrics::pairs_evaluated)
+        .def_readonly("constraint_resets", &MiniSync::API::Metrics::constraint_resets)
+        .def_readonly("update_ns", &MiniSync::API::Metrics::update_ns)
+        .def_readonly("cleanup_ns", &MiniSync::API::Metrics::cleanup_ns);
+
     // method definitions
     pyAlgo
         .def(py::init())
         .def("addDataPoint", &Algorithm::addDataPoint)
+        .def("addDataPoints", &Algorithm::addDataPoints)
         .def("getOffset", &Algorithm::getOffset)
         .def("getOffsetError", &Algorithm::getOffsetError)
         .def("getDrift", &Algorithm::getDrift)
-        .def("getDriftError", &Algorithm::getDriftError);
+        .def("getDriftError", &Algorithm::getDriftError)
+        .def("getMetrics", &Algorithm::getMetrics);
 
     pyTiny
         .def(py::init())
         .def("addDataPoint", &TinySyncAlgorithm::addDataPoint)
+        .def("addDataPoints", &TinySyncAlgorithm::addDataPoints)
         .def("getOffset", &TinySyncAlgorithm::getOffset)
         .def("getOffsetError", &TinySyncAlgorithm::getOffsetError)
         .def("getDrift", &TinySyncAlgorithm::getDrift)
-        .def("getDriftError", &TinySyncAlgorithm::getDriftError);
+        .def("getDriftError", &TinySyncAlgorithm::getDriftError)
+        .def("getMetrics", &TinySyncAlgorithm::getMetrics);
 
     pyMini
         .def(py::init())
         .def("addDataPoint", &MiniSyncAlgorithm::addDataPoint)
+        .def("addDataPoints", &MiniSyncAlgorithm::addDataPoints)
         .def("getOffset", &MiniSyncAlgorithm::getOffset)
         .def("getOffsetError", &MiniSyncAlgorithm::getOffsetError)
         .def("getDrift", &MiniSyncAlgorithm::getDrift)
-        .def("getDriftError", &MiniSyncAlgorithm::getDriftError);
+        .def("getDriftError", &MiniSyncAlgorithm::getDriftError)
+        .def("getMetrics", &MiniSyncAlgorithm::getMetrics);
 }
 
 
@@ -0,0 +1,190 @@
+/*
+* Author: Manuel Olguín Muñoz <manuel@olguin.se>
+*
+* Copyright© 2019 Manuel Olguín Muñoz
+* See LICENSE file included in the root directory of this project for licensing and copyright details.
+*/
+
+#include <minisync_api.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <string>
+#include <getopt.h>
+#include "trace.h"
+
+/*
+ * Offline replay of beacon traces (see trace.h) through TinySync and/or MiniSync, as fast as the algorithms go.
+ * Reports the throughput and final estimates of each algorithm, and optionally writes the estimates after every
+ * exchange to a CSV file.
+ */
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+    using MiniSync::Trace::MappedTrace;
+    using MiniSync::Trace::TraceRecord;
+    using MiniSync::Trace::toMicroseconds;
+
+    struct Options
+    {
+        bool tiny = true;
+        bool mini = true;
+        uint32_t window_samples = 0;
+        bool nanoseconds = false;
+        std::string output_prefix;
+    };
+
+    /*
+     * Streams every record through the algorithm, two data points per record like SyncNode.
+     * Returns false if the algorithm rejected the trace.
+     */
+    bool replay(const std::string& name,
+                const std::shared_ptr<MiniSync::API::Algorithm>& algo,
+                const MappedTrace& trace,
+                const Options& options)
+    {
+        FILE* out = nullptr;
+        if (!options.output_prefix.empty())
+        {
+            const std::string path = options.output_prefix + "." + name + ".csv";
+            out = fopen(path.c_str(), "w");
+            if (out == nullptr)
+            {
+                fprintf(stderr, "Could not open %s: %s\n", path.c_str(), strerror(errno));
+                return false;
+            }
+            fprintf(out, "record,Tb,drift,drift_error,offset,offset_error\n");
+        }
+
+        const TraceRecord* records = trace.records();
+        const size_t n = trace.count();
+        size_t i = 0;
+        auto t_start = clock::now();
+        try
+        {
+            for (; i < n; ++i)
+            {
+                const TraceRecord& r = records[i];
+                MiniSync::Trace::addRecord(*algo, r);
+
+                if (out != nullptr)
+                    fprintf(out, "%zu,%.3Lf,%.15Le,%.6Le,%.6Lf,%.6Lf\n",
+                            i, toMicroseconds(r.Tbt).count(),
+                            algo->getDrift(), algo->getDriftError(),
+                            algo->getOffset().count(), algo->getOffsetError().count());
+            }
+        }
+        catch (std::exception& e)
+        {
+            fprintf(stderr, "%s: record %zu: %s\n", name.c_str(), i, e.what());
+            if (out != nullptr) fclose(out);
+            return false;
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(clock::now() - t_start);
+        if (out != nullptr) fclose(out);
+
+        printf("%-8s %12zu records | %8.3f s | %8.3f M records/s | drift %.12Lf +/- %.3Le | "
+               "offset %.3Lf +/- %.3Lf µs\n",
+               name.c_str(), n, elapsed.count(), n / elapsed.count() / 1e6,
+               algo->getDrift(), algo->getDriftError(), algo->getOffset().count(), algo->getOffsetError().count());
+        return true;
+    }
+
+    void usage(const char* argv0)
+    {
+        fprintf(stderr,
+                "Usage: %s [options] TRACE\n"
+                "Replays a binary beacon trace through TinySync and MiniSync.\n\n"
+                "  -a ALGO    algorithm to run: tiny, mini or both (default)\n"
+                "  -w N       window of N samples for MiniSync (default: no window)\n"
+                "  -n         use integer nanosecond timestamps internally\n"
+                "  -o PREFIX  write the estimates after every record to PREFIX.<algorithm>.csv\n"
+                "  -h         show this message\n",
+                argv0);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    int opt;
+    char* end;
+    unsigned long window;
+    while ((opt = getopt(argc, argv, "a:w:no:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'a':
+                options.tiny = std::strcmp(optarg, "tiny") == 0 || std::strcmp(optarg, "both") == 0;
+                options.mini = std::strcmp(optarg, "mini") == 0 || std::strcmp(optarg, "both") == 0;
+                if (!options.tiny && !options.mini)
+                {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'w':
+                // validated here, as a bad value would otherwise throw outside of the try block below
+                errno = 0;
+                window = std::strtoul(optarg, &end, 10);
+                if (errno != 0 || end == optarg || *end != '\0' || optarg[0] == '-' ||
+                    window > std::numeric_limits<uint32_t>::max())
+                {
+                    usage(argv[0]);
+                    return 1;
+                }
+                options.window_samples = static_cast<uint32_t>(window);
+                break;
+            case 'n':
+                options.nanoseconds = true;
+                break;
+            case 'o':
+                options.output_prefix = optarg;
+                break;
+            case 'h':
+                usage(argv[0]);
+                return 0;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind != argc - 1)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    try
+    {
+        MappedTrace trace{argv[optind]};
+        const auto time = options.nanoseconds ? MiniSync::API::Factory::TimeRepresentation::INT64_NANOSECONDS
+                                              : MiniSync::API::Factory::TimeRepresentation::LONG_DOUBLE_MICROSECONDS;
+        bool ok = true;
+        if (options.tiny)
+        {
+            MiniSync::API::Factory::TinySyncOptions tiny_options;
+            tiny_options.time = time;
+            ok = replay("tinysync", MiniSync::API::Factory::createTinySync(tiny_options), trace, options) && ok;
+        }
+        if (options.mini)
+        {
+            MiniSync::API::Factory::MiniSyncOptions mini_options;
+            mini_options.window_samples = options.window_samples;
+            mini_options.time = time;
+            ok = replay("minisync", MiniSync::API::Factory::createMiniSync(mini_options), trace, options) && ok;
+        }
+        return ok ? 0 : 1;
+    }
+    catch (std::exception& e)
+    {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+}
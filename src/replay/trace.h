@@ -0,0 +1,195 @@
+/*
+* Author: Manuel Olguín Muñoz <manuel@olguin.se>
+*
+* Copyright© 2019 Manuel Olguín Muñoz
+* See LICENSE file included in the root directory of this project for licensing and copyright details.
+*/
+
+#ifndef MINISYNCPP_TRACE_H
+#define MINISYNCPP_TRACE_H
+
+#include <minisync_api.h>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace MiniSync
+{
+    /*
+     * Binary trace of beacon exchanges, as written by SyncNode (--trace) and read by minisync_replay.
+     *
+     * A trace is a TraceHeader followed by a flat array of TraceRecords, in native byte order, like checkpoints. A
+     * trace recorded on a host with the other byte order fails the version check. Each record holds the timestamps of
+     * one exchange, in integer ns: local send time (To), reference receive and reply times (Tbr, Tbt) and local
+     * receive time (Tr), with any minimum delay compensation already applied. Like SyncNode, the replay adds two data
+     * points per exchange: (To, Tbr, Tr) and (To, Tbt, Tr).
+     */
+    namespace Trace
+    {
+        static const char MAGIC[4] = {'M', 'S', 'T', 'R'};
+        static const uint32_t VERSION = 1;
+
+        struct TraceHeader
+        {
+            char magic[4];
+            uint32_t version;
+            uint32_t record_size; // sizeof(TraceRecord)
+            uint32_t reserved;
+        };
+
+        struct TraceRecord
+        {
+            int64_t To;
+            int64_t Tbr;
+            int64_t Tbt;
+            int64_t Tr;
+        };
+
+        static_assert(sizeof(TraceHeader) == 16, "Unexpected padding in TraceHeader.");
+        static_assert(sizeof(TraceRecord) == 32, "Unexpected padding in TraceRecord.");
+
+        inline int64_t toNanoseconds(us_t t)
+        {
+            return static_cast<int64_t>(std::llround(t.count() * 1000));
+        }
+
+        inline us_t toMicroseconds(int64_t ns)
+        {
+            return us_t{static_cast<long double>(ns) / 1000};
+        }
+
+        /*
+         * Adds the two data points of an exchange to the algorithm, the same way SyncNode does.
+         */
+        inline void addRecord(API::Algorithm& algo, const TraceRecord& r)
+        {
+            const us_t to = toMicroseconds(r.To);
+            const us_t tr = toMicroseconds(r.Tr);
+            algo.addDataPoint(to, toMicroseconds(r.Tbr), tr);
+            algo.addDataPoint(to, toMicroseconds(r.Tbt), tr);
+        }
+
+        /*
+         * Appends records to a new trace file, which is complete once the writer is destroyed.
+         */
+        class Writer
+        {
+        public:
+            explicit Writer(const std::string& path) :
+                file(fopen(path.c_str(), "wb"))
+            {
+                if (this->file == nullptr)
+                    throw std::runtime_error("Could not open " + path + ": " + strerror(errno));
+
+                TraceHeader header{};
+                std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+                header.version = VERSION;
+                header.record_size = sizeof(TraceRecord);
+                if (fwrite(&header, sizeof(header), 1, this->file) != 1)
+                {
+                    fclose(this->file);
+                    throw std::runtime_error("Could not write to " + path + ".");
+                }
+            }
+
+            Writer(const Writer&) = delete;
+            Writer& operator=(const Writer&) = delete;
+
+            ~Writer()
+            {
+                fclose(this->file);
+            }
+
+            // buffered, so this doesn't go to the kernel for every record
+            void write(const TraceRecord& record)
+            {
+                if (fwrite(&record, sizeof(record), 1, this->file) != 1)
+                    throw std::runtime_error("Could not write trace record.");
+            }
+
+        private:
+            FILE* file;
+        };
+
+        /*
+         * Read-only memory mapping of a whole trace file.
+         */
+        class MappedTrace
+        {
+        public:
+            explicit MappedTrace(const char* path)
+            {
+                int fd = open(path, O_RDONLY);
+                if (fd < 0)
+                    throw std::runtime_error(std::string("Could not open ") + path + ": " + strerror(errno));
+
+                struct stat st{};
+                if (fstat(fd, &st) < 0)
+                {
+                    close(fd);
+                    throw std::runtime_error(std::string("Could not stat ") + path + ": " + strerror(errno));
+                }
+                this->size = static_cast<size_t>(st.st_size);
+                if (this->size < sizeof(TraceHeader))
+                {
+                    close(fd);
+                    throw std::runtime_error(std::string(path) + " is too short to be a trace.");
+                }
+
+                this->data = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+                close(fd);
+                if (this->data == MAP_FAILED)
+                    throw std::runtime_error(std::string("Could not map ") + path + ": " + strerror(errno));
+                madvise(this->data, this->size, MADV_SEQUENTIAL);
+
+                // the destructor won't run if the constructor throws
+                const auto* header = static_cast<const TraceHeader*>(this->data);
+                const char* error = nullptr;
+                if (std::memcmp(header->magic, MAGIC, sizeof(header->magic)) != 0)
+                    error = " is not a trace.";
+                else if (header->version != VERSION || header->record_size != sizeof(TraceRecord))
+                    error = " has an unsupported trace version, or was recorded with a different byte order.";
+                else if ((this->size - sizeof(TraceHeader)) % sizeof(TraceRecord) != 0)
+                    error = " ends with a partial record.";
+                if (error != nullptr)
+                {
+                    munmap(this->data, this->size);
+                    throw std::runtime_error(std::string(path) + error);
+                }
+            }
+
+            MappedTrace(const MappedTrace&) = delete;
+            MappedTrace& operator=(const MappedTrace&) = delete;
+
+            ~MappedTrace()
+            {
+                munmap(this->data, this->size);
+            }
+
+            const TraceRecord* records() const
+            {
+                return reinterpret_cast<const TraceRecord*>(static_cast<const uint8_t*>(this->data) +
+                                                            sizeof(TraceHeader));
+            }
+
+            size_t count() const
+            {
+                return (this->size - sizeof(TraceHeader)) / sizeof(TraceRecord);
+            }
+
+        private:
+            void* data;
+            size_t size;
+        };
+    }
+}
+
+#endif //MINISYNCPP_TRACE_H
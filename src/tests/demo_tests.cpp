@@ -0,0 +1,361 @@
+/*
+* Author: Manuel Olguín Muñoz <manuel@olguin.se>
+*
+* Copyright© 2019 Manuel Olguín Muñoz
+* See LICENSE file included in the root directory of this project for licensing and copyright details.
+*/
+#include <demo_config.h>
+#include <loguru.hpp>
+#include "../demo/node.h"
+#include "../demo/exception.h"
+#include "../bench/alloc_stats.h"
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+
+namespace
+{
+    const uint16_t REFERENCE_PORT = 14338;
+    const uint16_t CLIENT_PORT = 14339;
+
+    /*
+     * Talks to a ReferenceNode on loopback through the message path of Node, one beacon at a time.
+     */
+    class TestClient : public MiniSync::Node
+    {
+    public:
+        explicit TestClient(uint16_t port = CLIENT_PORT) :
+            Node(port, MiniSync::Protocol::NodeMode::SYNC, MiniSync::TimestampOptions{}),
+            peer_addr(MiniSync::SOCKADDR{}),
+            seq(0)
+        {
+            memset(&this->peer_addr, 0, sizeof(this->peer_addr));
+            this->peer_addr.sin_family = AF_INET;
+            this->peer_addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+            this->peer_addr.sin_port = htons(REFERENCE_PORT);
+
+            // don't hang if the reference doesn't answer
+            struct timeval timeout{1, 0};
+            setsockopt(this->sock_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            this->beacon.mutable_beacon();
+        }
+
+        void run() override
+        {}
+
+        bool handshake()
+        {
+            MiniSync::Protocol::MiniSyncMsg msg{};
+            msg.mutable_handshake()->set_mode(this->mode);
+            msg.mutable_handshake()->set_version_major(PROTOCOL_VERSION_MAJOR);
+            msg.mutable_handshake()->set_version_minor(PROTOCOL_VERSION_MINOR);
+            this->send_message(msg, (struct sockaddr*) &this->peer_addr);
+
+            MiniSync::Protocol::MiniSyncMsg& reply = this->incoming.reset();
+            try
+            {
+                this->recv_message(reply, nullptr);
+            }
+            catch (MiniSync::Exceptions::TimeoutException& e)
+            {
+                return false;
+            }
+            connect(this->sock_fd, (struct sockaddr*) &this->peer_addr, sizeof(this->peer_addr));
+            return reply.has_handshake_r() &&
+                   reply.handshake_r().status() == MiniSync::Protocol::HandshakeReply_Status_SUCCESS;
+        }
+
+        // sends beacons one after the other, and returns how many got the right reply (stops at the first timeout)
+        uint32_t beacons(uint32_t n)
+        {
+            uint32_t replies = 0;
+            try
+            {
+                for (uint32_t i = 0; i < n; ++i)
+                {
+                    this->beacon.mutable_beacon()->set_seq(++this->seq);
+                    this->send_message(this->beacon, nullptr);
+                    MiniSync::Protocol::MiniSyncMsg& reply = this->incoming.reset();
+                    this->recv_message(reply, nullptr);
+                    if (reply.has_beacon_r() && reply.beacon_r().seq() == this->seq) replies++;
+                }
+            }
+            catch (MiniSync::Exceptions::TimeoutException& e)
+            {}
+            return replies;
+        }
+
+    private:
+        MiniSync::SOCKADDR peer_addr;
+        MiniSync::Protocol::MiniSyncMsg beacon;
+        MiniSync::ReusableMsg incoming;
+        uint32_t seq;
+    };
+
+    /*
+     * Exposes the batched I/O of Node.
+     */
+    class BatchNode : public MiniSync::Node
+    {
+    public:
+        explicit BatchNode(uint16_t port) :
+            Node(port, MiniSync::Protocol::NodeMode::REFERENCE, MiniSync::TimestampOptions{})
+        {
+            int flags = fcntl(this->sock_fd, F_GETFL, 0);
+            fcntl(this->sock_fd, F_SETFL, flags | O_NONBLOCK);
+            this->init_batch_io(this->sock_fd, 4, this->rx, this->tx);
+        }
+
+        void run() override
+        {}
+
+        Batch rx;
+        Batch tx;
+
+        uint32_t send(uint32_t count)
+        { return this->send_batch(this->sock_fd, this->tx, count); }
+
+        uint32_t recv()
+        { return this->recv_batch(this->sock_fd, this->rx); }
+    };
+
+    /*
+     * Allocations by SyncNode::run() on the calling thread while synchronizing with a local reference for the given
+     * time. TinySync keeps a fixed number of points, so anything else would come from the node.
+     */
+    uint64_t syncing_allocations(std::chrono::milliseconds duration, uint64_t& exchanges)
+    {
+        MiniSync::ReferenceNode reference{REFERENCE_PORT};
+        std::thread server([&reference]() { reference.run(); });
+
+        std::string peer = "127.0.0.1";
+        auto algo = MiniSync::API::Factory::createTinySync();
+        uint64_t allocations;
+        {
+            MiniSync::SyncNode node{CLIENT_PORT, peer, REFERENCE_PORT, std::shared_ptr<MiniSync::API::Algorithm>{algo}};
+            std::thread timer([&node, duration]()
+                              {
+                                  std::this_thread::sleep_for(duration);
+                                  node.shut_down();
+                              });
+
+            MiniSync::Bench::resetAllocStats();
+            try
+            {
+                node.run();
+            }
+            catch (std::exception& e)
+            {} // shut_down() closes the socket under it
+            allocations = MiniSync::Bench::allocStats().allocations;
+            timer.join();
+        }
+        reference.shut_down();
+        server.join();
+
+        exchanges = algo->getMetrics().samples / 2; // two data points per exchange
+        return allocations;
+    }
+
+    /*
+     * Allocations by ReferenceNode::run() on the calling thread while serving a single client through a handshake and
+     * the given number of beacons.
+     */
+    uint64_t serving_allocations(uint32_t batch_size, uint32_t beacons, uint32_t& replies)
+    {
+        MiniSync::ReferenceNode reference{REFERENCE_PORT, batch_size};
+        std::thread client([&reference, beacons, &replies]()
+                           {
+                               TestClient node{};
+                               replies = node.handshake() ? node.beacons(beacons) : 0;
+                               reference.shut_down();
+                           });
+
+        MiniSync::Bench::resetAllocStats();
+        reference.run();
+        const uint64_t allocations = MiniSync::Bench::allocStats().allocations;
+        client.join();
+        return allocations;
+    }
+
+    /*
+     * Has the given number of clients, each on its own port, handshake with the reference and send it beacons at the
+     * same time, and returns how many replies each of them got.
+     */
+    std::vector<uint32_t> serve_clients(MiniSync::ReferenceNode& reference, uint16_t clients, uint32_t beacons)
+    {
+        // one after the other, as each estimates its minimum delays on the same loopback port
+        std::vector<std::unique_ptr<TestClient>> nodes;
+        for (uint16_t i = 0; i < clients; ++i)
+            nodes.emplace_back(new TestClient{static_cast<uint16_t>(CLIENT_PORT + i)});
+
+        std::vector<uint32_t> replies(clients, 0);
+        std::vector<std::thread> threads;
+        for (uint16_t i = 0; i < clients; ++i)
+        {
+            TestClient* node = nodes[i].get();
+            uint32_t* got = &replies[i];
+            threads.emplace_back([node, beacons, got]()
+                                 { *got = node->handshake() ? node->beacons(beacons) : 0; });
+        }
+        std::thread stop([&threads, &reference]()
+                         {
+                             for (auto& thread: threads) thread.join();
+                             reference.shut_down();
+                         });
+
+        reference.run();
+        stop.join();
+        return replies;
+    }
+}
+
+TEST_CASE("Sync nodes exchange beacons without allocating", "[demo]")
+{
+    loguru::g_stderr_verbosity = loguru::Verbosity_ERROR;
+
+    // the handshake allocates, but the beacons after it shouldn't allocate anything
+    uint64_t few_exchanges = 0;
+    uint64_t many_exchanges = 0;
+    const uint64_t few = syncing_allocations(std::chrono::milliseconds{350}, few_exchanges);
+    const uint64_t many = syncing_allocations(std::chrono::milliseconds{1500}, many_exchanges);
+
+    REQUIRE(few_exchanges >= 2);
+    REQUIRE(many_exchanges >= few_exchanges + 5);
+    REQUIRE(many == few);
+}
+
+TEST_CASE("Reference nodes answer beacons without allocating", "[demo]")
+{
+    loguru::g_stderr_verbosity = loguru::Verbosity_ERROR;
+    const uint32_t batch_size = GENERATE(1u, 64u);
+
+    // the handshake allocates the state of the client, but the beacons after it shouldn't allocate anything
+    uint32_t few_replies = 0;
+    uint32_t many_replies = 0;
+    const uint64_t few = serving_allocations(batch_size, 10, few_replies);
+    const uint64_t many = serving_allocations(batch_size, 1000, many_replies);
+
+    REQUIRE(few_replies == 10);
+    REQUIRE(many_replies == 1000);
+    REQUIRE(many == few);
+}
+
+TEST_CASE("Reference nodes serve several clients at once", "[demo]")
+{
+    loguru::g_stderr_verbosity = loguru::Verbosity_ERROR;
+    const uint32_t batch_size = GENERATE(1u, 64u);
+
+    MiniSync::ReferenceNode reference{REFERENCE_PORT, batch_size};
+    const std::vector<uint32_t> replies = serve_clients(reference, 2, 500);
+
+    // each client only counts the replies to its own beacons
+    REQUIRE(replies[0] == 500);
+    REQUIRE(replies[1] == 500);
+    const MiniSync::ReferenceNode::Counters counters = reference.get_counters();
+    REQUIRE(counters.clients == 2);
+    REQUIRE(counters.beacons == 1000);
+    REQUIRE(counters.ignored == 0);
+}
+
+TEST_CASE("Reference nodes with several workers answer every request", "[demo]")
+{
+    loguru::g_stderr_verbosity = loguru::Verbosity_ERROR;
+    const uint32_t batch_size = GENERATE(1u, 64u);
+
+    // the workers share the port through SO_REUSEPORT, and the kernel spreads the clients among them
+    MiniSync::ReferenceNode reference{REFERENCE_PORT, batch_size, 2};
+    const std::vector<uint32_t> replies = serve_clients(reference, 4, 200);
+
+    for (uint32_t got: replies)
+        REQUIRE(got == 200);
+    const MiniSync::ReferenceNode::Counters counters = reference.get_counters();
+    REQUIRE(counters.clients == 4);
+    REQUIRE(counters.handshakes == 4);
+    REQUIRE(counters.beacons == 800);
+    REQUIRE(counters.dropped == 0);
+}
+
+TEST_CASE("Kernel timestamps stamp every exchange", "[demo]")
+{
+    loguru::g_stderr_verbosity = loguru::Verbosity_ERROR;
+    const uint32_t batch_size = GENERATE(1u, 64u);
+    const std::string trace_path = "minisync_demo_test.trace";
+
+    // software timestamps, which the kernel also takes on loopback
+    MiniSync::TimestampOptions kernel;
+    kernel.kernel = true;
+
+    std::string peer = "127.0.0.1";
+    auto algo = MiniSync::API::Factory::createTinySync();
+    {
+        MiniSync::ReferenceNode reference{REFERENCE_PORT, batch_size, 1, kernel};
+        std::thread server([&reference]() { reference.run(); });
+        {
+            MiniSync::SyncNode node{CLIENT_PORT, peer, REFERENCE_PORT, std::shared_ptr<MiniSync::API::Algorithm>{algo},
+                                    "", -1.0, -1.0, kernel, trace_path};
+            std::thread timer([&node]()
+                              {
+                                  std::this_thread::sleep_for(std::chrono::milliseconds{500});
+                                  node.shut_down();
+                              });
+            try
+            {
+                node.run();
+            }
+            catch (std::exception& e)
+            {} // shut_down() closes the socket under it
+            timer.join();
+            REQUIRE(node.get_unstamped() == 0);
+        }
+        reference.shut_down();
+        server.join();
+        REQUIRE(reference.get_unstamped() == 0);
+    }
+
+    // the trace is complete once the node is gone
+    {
+        MiniSync::Trace::MappedTrace trace{trace_path.c_str()};
+        REQUIRE(trace.count() >= 5);
+        REQUIRE(algo->getMetrics().samples == 2 * trace.count());
+        for (size_t i = 0; i < trace.count(); ++i)
+        {
+            const MiniSync::Trace::TraceRecord& r = trace.records()[i];
+            REQUIRE(r.To < r.Tr);
+            REQUIRE(r.Tbr <= r.Tbt);
+        }
+    }
+    std::remove(trace_path.c_str());
+}
+
+TEST_CASE("Batches skip the datagrams the kernel refuses", "[demo]")
+{
+    loguru::g_stderr_verbosity = loguru::Verbosity_ERROR;
+    BatchNode sender{CLIENT_PORT};
+    BatchNode receiver{REFERENCE_PORT};
+
+    MiniSync::SOCKADDR to_receiver{};
+    to_receiver.sin_family = AF_INET;
+    to_receiver.sin_addr.s_addr = inet_addr("127.0.0.1");
+    to_receiver.sin_port = htons(REFERENCE_PORT);
+    // sending to the broadcast address without SO_BROADCAST fails with EACCES
+    MiniSync::SOCKADDR refused = to_receiver;
+    refused.sin_addr.s_addr = INADDR_BROADCAST;
+
+    const MiniSync::SOCKADDR addrs[3] = {to_receiver, refused, to_receiver};
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        sender.tx.datagrams[i].addr = addrs[i];
+        sender.tx.datagrams[i].len = 1;
+        sender.tx.datagrams[i].data[0] = static_cast<uint8_t>(i);
+    }
+
+    REQUIRE(sender.send(3) == 2);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    REQUIRE(receiver.recv() == 2);
+    REQUIRE(receiver.rx.datagrams[0].data[0] == 0);
+    REQUIRE(receiver.rx.datagrams[1].data[0] == 2);
+}
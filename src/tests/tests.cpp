@@ -5,10 +5,26 @@
 * See LICENSE file included in the root directory of this project for licensing and copyright details.
 */
 #include <minisync_api.h>
+#include <basic_sync.h>
+#include <fixed_tinysync.h>
+#include <fixed_minisync.h>
+#include <adjusted_clock.h>
+#include <workload.h>
+#include "../bench/alloc_stats.h"
+#include "../replay/trace.h"
 #include <catch2/catch.hpp>
 #include <sstream>
-#include <thread> // sleep_for
+#include <algorithm>
+#include <atomic>
+#include <thread> // concurrent readers
 #include <random>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <vector>
 
 namespace Catch
 {
@@ -81,28 +97,1065 @@ TEST_CASE("Side by side tests", "[timing]")
     auto tiny = MiniSync::API::Factory::createTinySync();
     auto mini = MiniSync::API::Factory::createMiniSync();
 
-    auto T0 = std::chrono::steady_clock::now();
-    using clock = std::chrono::steady_clock;
-
-    // we'll use some random delays, that way we get some variability in the inputs to the algorithms
-    std::default_random_engine gen;
-    std::uniform_int_distribution<uint32_t> dist(0, 10);
+    // simulated exchanges with random delays, that way we get some variability in the inputs to the algorithms
+    MiniSync::Workload::Options options;
+    options.forward.mean_jitter = 5000;
+    options.backward.mean_jitter = 5000;
+    MiniSync::Workload::Generator generator{1, options};
 
     // run algorithms in a loop. MiniSync should always give an equal OR better result compared to TinySync
-    for (int i = 0; i < 50; ++i)
+    for (int i = 0; i < 1000; ++i)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds{dist(gen)});
-        
-        auto To = clock::now() - T0;
-        std::this_thread::sleep_for(std::chrono::milliseconds{dist(gen)});
-        auto Tb = clock::now() - T0;
-        std::this_thread::sleep_for(std::chrono::milliseconds{dist(gen)});
-        auto Tr = clock::now() - T0;
+        const auto s = generator.next().point;
+        tiny->addDataPoint(s.To, s.Tb, s.Tr);
+        mini->addDataPoint(s.To, s.Tb, s.Tr);
+
+        REQUIRE(mini->getOffsetError() <= tiny->getOffsetError());
+        REQUIRE(mini->getDriftError() <= tiny->getDriftError());
+    }
+}
+
+TEST_CASE("Estimates bound the true drift and offset", "[TinySync, MiniSync]")
+{
+    auto tiny = MiniSync::API::Factory::createTinySync();
+    auto mini = MiniSync::API::Factory::createMiniSync();
 
-        tiny->addDataPoint(To, Tb, Tr);
-        mini->addDataPoint(To, Tb, Tr);
+    // simulated local clock, local = drift * ref + offset
+    MiniSync::Workload::Options options;
+    options.skew = 25e-6;
+    options.offset = 5000.0; // µs
+    const long double drift = 1 + options.skew;
+    const long double offset = options.offset;
+    MiniSync::Workload::Generator generator{1, options};
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        const MiniSync::API::DataPoint p = generator.next().point;
+        tiny->addDataPoint(p.To, p.Tb, p.Tr);
+        mini->addDataPoint(p.To, p.Tb, p.Tr);
+
+        if (i == 0) continue;
+        for (const auto& algo: {tiny, mini})
+        {
+            REQUIRE(std::abs(algo->getDrift() - drift) <= algo->getDriftError() * (1 + 1e-9));
+            REQUIRE(std::abs((algo->getOffset() - MiniSync::us_t{offset}).count())
+                    <= algo->getOffsetError().count() * (1 + 1e-9));
+        }
 
         REQUIRE(mini->getOffsetError() <= tiny->getOffsetError());
         REQUIRE(mini->getDriftError() <= tiny->getDriftError());
     }
 }
+
+/*
+ * Exhaustive search over every pair of points in samples (Tb, To, Tr):
+ * steepest line under every high point and above every low point goes through some (low_i, high_j), i < j
+ * and the flattest one through some (high_i, low_j), i < j
+ */
+static void requireTightestBounds(const std::shared_ptr<MiniSync::API::Algorithm>& algorithm,
+                                  const std::vector<std::tuple<long double, long double, long double>>& samples)
+{
+    long double a_upper = std::numeric_limits<long double>::max(), b_lower = 0;
+    long double a_lower = std::numeric_limits<long double>::lowest(), b_upper = 0;
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        for (size_t j = i + 1; j < samples.size(); ++j)
+        {
+            long double dx = std::get<0>(samples[j]) - std::get<0>(samples[i]);
+            long double a_up = (std::get<2>(samples[j]) - std::get<1>(samples[i])) / dx;
+            long double a_lo = (std::get<1>(samples[j]) - std::get<2>(samples[i])) / dx;
+            if (a_up < a_upper)
+            {
+                a_upper = a_up;
+                b_lower = std::get<1>(samples[i]) - a_up * std::get<0>(samples[i]);
+            }
+            if (a_lo > a_lower)
+            {
+                a_lower = a_lo;
+                b_upper = std::get<2>(samples[i]) - a_lo * std::get<0>(samples[i]);
+            }
+        }
+    }
+
+    REQUIRE(algorithm->getDrift() == Approx((a_upper + a_lower) / 2).epsilon(1e-12));
+    REQUIRE(algorithm->getDriftError() == Approx((a_upper - a_lower) / 2).epsilon(1e-6));
+    REQUIRE(algorithm->getOffset().count() == Approx((b_upper + b_lower) / 2).epsilon(1e-9));
+    REQUIRE(algorithm->getOffsetError().count() == Approx((b_upper - b_lower) / 2).epsilon(1e-6));
+}
+
+TEST_CASE("MiniSync finds the tightest possible bounds", "[MiniSync]")
+{
+    auto mini = MiniSync::API::Factory::createMiniSync();
+
+    MiniSync::Workload::Options options;
+    options.interval = 50000.0;
+    options.skew = -40e-6;
+    options.offset = -3000.0; // µs
+    MiniSync::Workload::Generator generator{2, options};
+
+    std::vector<std::tuple<long double, long double, long double>> samples; // (Tb, To, Tr)
+    for (int i = 0; i < 200; ++i)
+    {
+        const MiniSync::API::DataPoint p = generator.next().point;
+        samples.emplace_back(p.Tb.count(), p.To.count(), p.Tr.count());
+        mini->addDataPoint(p.To, p.Tb, p.Tr);
+    }
+
+    requireTightestBounds(mini, samples);
+}
+
+TEST_CASE("Windowed MiniSync finds the tightest bounds within the window", "[MiniSync]")
+{
+    const uint32_t window = 50;
+    MiniSync::API::Factory::MiniSyncOptions options;
+    options.window_samples = window;
+    auto mini = MiniSync::API::Factory::createMiniSync(options);
+
+    MiniSync::Workload::Options workload;
+    workload.interval = 50000.0;
+    workload.skew = 15e-6;
+    workload.offset = 1200.0; // µs
+    MiniSync::Workload::Generator generator{4, workload};
+
+    std::vector<std::tuple<long double, long double, long double>> samples; // (Tb, To, Tr)
+    for (int i = 0; i < 400; ++i)
+    {
+        const MiniSync::API::DataPoint p = generator.next().point;
+        samples.emplace_back(p.Tb.count(), p.To.count(), p.Tr.count());
+        mini->addDataPoint(p.To, p.Tb, p.Tr);
+
+        if (samples.size() > window && i % 7 == 0)
+            requireTightestBounds(mini, {samples.end() - window, samples.end()});
+    }
+}
+
+TEST_CASE("Windowed MiniSync follows changes in drift", "[MiniSync]")
+{
+    MiniSync::API::Factory::MiniSyncOptions by_samples;
+    by_samples.window_samples = 100;
+    MiniSync::API::Factory::MiniSyncOptions by_span;
+    by_span.window_span = MiniSync::us_t{10 * 1000000.0}; // 10 s
+
+    std::shared_ptr<MiniSync::API::Algorithm> algorithm;
+    SECTION("Window by number of samples")
+    {
+        algorithm = MiniSync::API::Factory::createMiniSync(by_samples);
+    }
+    SECTION("Window by timespan")
+    {
+        algorithm = MiniSync::API::Factory::createMiniSync(by_span);
+    }
+
+    std::mt19937 gen{3};
+    std::uniform_real_distribution<long double> delay(10.0, 500.0);
+
+    // drift changes halfway through, e.g. because of a change in temperature
+    long double drift = 1.0 + 30e-6;
+    long double local = 0; // local clock at the latest beacon
+    long double t = 0;
+    for (int i = 0; i < 1000; ++i)
+    {
+        if (i == 500) drift = 1.0 - 10e-6;
+
+        t += 100000.0; // beacons every 100 ms
+        local += drift * 100000.0;
+        MiniSync::us_t To{local - drift * delay(gen)};
+        MiniSync::us_t Tr{local + drift * delay(gen)};
+        algorithm->addDataPoint(To, MiniSync::us_t{t}, Tr);
+
+        // after a full window has passed, old points can't affect the estimates anymore
+        if (i >= 500 + 100)
+            REQUIRE(std::abs(algorithm->getDrift() - drift) <= algorithm->getDriftError() * (1 + 1e-9));
+    }
+}
+
+TEST_CASE("MiniSync rejects invalid windows", "[MiniSync]")
+{
+    MiniSync::API::Factory::MiniSyncOptions options;
+    options.window_samples = 1;
+    REQUIRE_THROWS_AS(MiniSync::API::Factory::createMiniSync(options), std::invalid_argument);
+
+    options.window_samples = 0;
+    options.window_span = MiniSync::us_t{-1.0};
+    REQUIRE_THROWS_AS(MiniSync::API::Factory::createMiniSync(options), std::invalid_argument);
+}
+
+TEST_CASE("Batches of samples give the same estimates as single samples", "[MiniSync]")
+{
+    MiniSync::API::Factory::MiniSyncOptions options;
+    options.window_samples = 40;
+
+    std::shared_ptr<MiniSync::API::Algorithm> single;
+    std::shared_ptr<MiniSync::API::Algorithm> batched;
+    SECTION("MiniSync")
+    {
+        single = MiniSync::API::Factory::createMiniSync();
+        batched = MiniSync::API::Factory::createMiniSync();
+    }
+    SECTION("Windowed MiniSync")
+    {
+        single = MiniSync::API::Factory::createMiniSync(options);
+        batched = MiniSync::API::Factory::createMiniSync(options);
+    }
+
+    MiniSync::Workload::Generator generator{5};
+    std::mt19937 gen{5};
+    std::uniform_int_distribution<size_t> batch_size(1, 30);
+
+    std::vector<MiniSync::API::DataPoint> batch;
+    for (int i = 0; i < 50; ++i)
+    {
+        batch.resize(batch_size(gen));
+        generator.fill(batch.data(), batch.size());
+        for (const auto& p: batch)
+            single->addDataPoint(p.To, p.Tb, p.Tr);
+        batched->addDataPoints(batch.data(), batch.size());
+
+        REQUIRE(batched->getDrift() == Approx(single->getDrift()).epsilon(1e-12));
+        REQUIRE(batched->getDriftError() == Approx(single->getDriftError()).epsilon(1e-9));
+        REQUIRE(batched->getOffset().count() == Approx(single->getOffset().count()).epsilon(1e-12));
+        REQUIRE(batched->getOffsetError().count() == Approx(single->getOffsetError().count()).epsilon(1e-9));
+    }
+}
+
+TEST_CASE("TinySync accepts batches of samples", "[TinySync]")
+{
+    auto tiny = MiniSync::API::Factory::createTinySync();
+
+    MiniSync::Workload::Options options;
+    options.skew = -25e-6;
+    options.offset = -500.0; // µs
+    const long double drift = 1 + options.skew;
+    const long double offset = options.offset;
+    MiniSync::Workload::Generator generator{6, options};
+
+    std::vector<MiniSync::API::DataPoint> batch(16);
+    for (int i = 0; i < 50; ++i)
+    {
+        generator.fill(batch.data(), batch.size());
+        tiny->addDataPoints(batch.data(), batch.size());
+
+        REQUIRE(std::abs(tiny->getDrift() - drift) <= tiny->getDriftError() * (1 + 1e-9));
+        REQUIRE(std::abs((tiny->getOffset() - MiniSync::us_t{offset}).count())
+                <= tiny->getOffsetError().count() * (1 + 1e-9));
+    }
+}
+
+TEST_CASE("Lazy mode gives exactly the same estimates as eager mode", "[TinySync][MiniSync]")
+{
+    std::shared_ptr<MiniSync::API::Algorithm> eager;
+    std::shared_ptr<MiniSync::API::Algorithm> lazy;
+    SECTION("TinySync")
+    {
+        MiniSync::API::Factory::TinySyncOptions options;
+        eager = MiniSync::API::Factory::createTinySync(options);
+        options.lazy = true;
+        lazy = MiniSync::API::Factory::createTinySync(options);
+    }
+    SECTION("MiniSync")
+    {
+        MiniSync::API::Factory::MiniSyncOptions options;
+        eager = MiniSync::API::Factory::createMiniSync(options);
+        options.lazy = true;
+        lazy = MiniSync::API::Factory::createMiniSync(options);
+    }
+    SECTION("Windowed MiniSync")
+    {
+        MiniSync::API::Factory::MiniSyncOptions options;
+        options.window_samples = 64;
+        eager = MiniSync::API::Factory::createMiniSync(options);
+        options.lazy = true;
+        lazy = MiniSync::API::Factory::createMiniSync(options);
+    }
+
+    MiniSync::Workload::Generator generator{7};
+    // read every few samples, sometimes only after more samples than fit in the queue
+    std::mt19937 gen{7};
+    std::uniform_int_distribution<int> reads(1, 3000);
+
+    for (int i = 0; i < 20; ++i)
+    {
+        for (int n = reads(gen); n > 0; --n)
+        {
+            const MiniSync::API::DataPoint p = generator.next().point;
+            eager->addDataPoint(p.To, p.Tb, p.Tr);
+            lazy->addDataPoint(p.To, p.Tb, p.Tr);
+        }
+
+        REQUIRE(lazy->getDrift() == eager->getDrift());
+        REQUIRE(lazy->getDriftError() == eager->getDriftError());
+        REQUIRE(lazy->getOffset() == eager->getOffset());
+        REQUIRE(lazy->getOffsetError() == eager->getOffsetError());
+    }
+}
+
+TEST_CASE("Integer nanosecond timestamps give the same estimates as long double", "[TinySync][MiniSync]")
+{
+    std::shared_ptr<MiniSync::API::Algorithm> ld;
+    std::shared_ptr<MiniSync::API::Algorithm> ns;
+    SECTION("TinySync")
+    {
+        MiniSync::API::Factory::TinySyncOptions options;
+        ld = MiniSync::API::Factory::createTinySync(options);
+        options.time = MiniSync::API::Factory::TimeRepresentation::INT64_NANOSECONDS;
+        ns = MiniSync::API::Factory::createTinySync(options);
+    }
+    SECTION("MiniSync")
+    {
+        MiniSync::API::Factory::MiniSyncOptions options;
+        ld = MiniSync::API::Factory::createMiniSync(options);
+        options.time = MiniSync::API::Factory::TimeRepresentation::INT64_NANOSECONDS;
+        ns = MiniSync::API::Factory::createMiniSync(options);
+    }
+
+    MiniSync::Workload::Options options;
+    options.interval = 60 * 1000000.0;
+    options.skew = -60e-6;
+    options.offset = 4321.0; // µs
+    const long double drift = 1 + options.skew;
+    const long double offset = options.offset;
+    MiniSync::Workload::Generator generator{8, options};
+
+    // a week of samples, with timestamps rounded to whole ns so that both representations get the same input
+    auto whole_ns = [](MiniSync::us_t t)
+    { return MiniSync::us_t{std::round(t.count() * 1000) / 1000}; };
+    for (int i = 0; i < 10000; ++i)
+    {
+        const MiniSync::API::DataPoint p = generator.next().point;
+        const MiniSync::us_t To = whole_ns(p.To);
+        const MiniSync::us_t Tb = whole_ns(p.Tb);
+        const MiniSync::us_t Tr = whole_ns(p.Tr);
+        ld->addDataPoint(To, Tb, Tr);
+        ns->addDataPoint(To, Tb, Tr);
+    }
+
+    // rounding in double stays well below the error bounds (see time_types.h)
+    REQUIRE(std::abs(ns->getDrift() - ld->getDrift()) < 1e-15);
+    REQUIRE(std::abs(ns->getDriftError() - ld->getDriftError()) < 1e-15);
+    REQUIRE(std::abs((ns->getOffset() - ld->getOffset()).count()) < 1e-3);
+    REQUIRE(std::abs((ns->getOffsetError() - ld->getOffsetError()).count()) < 1e-3);
+    REQUIRE(std::abs(ns->getDrift() - drift) <= ns->getDriftError());
+    REQUIRE(std::abs((ns->getOffset() - MiniSync::us_t{offset}).count()) <= ns->getOffsetError().count());
+}
+
+TEST_CASE("Header-only BasicSync matches the API algorithms", "[TinySync][MiniSync]")
+{
+    MiniSync::BasicSync<MiniSync::Retention::TinySync> tiny;
+    MiniSync::BasicSync<MiniSync::Retention::MiniSync, MiniSync::Time::Int64Nanoseconds> mini;
+
+    MiniSync::API::Factory::MiniSyncOptions options;
+    options.time = MiniSync::API::Factory::TimeRepresentation::INT64_NANOSECONDS;
+    auto api_tiny = MiniSync::API::Factory::createTinySync();
+    auto api_mini = MiniSync::API::Factory::createMiniSync(options);
+
+    MiniSync::Workload::Options workload;
+    workload.skew = 45e-6;
+    workload.offset = -750.0; // µs
+    MiniSync::Workload::Generator generator{9, workload};
+
+    for (int i = 0; i < 500; ++i)
+    {
+        const MiniSync::API::DataPoint p = generator.next().point;
+        // whole ns, so that both representations get the same input
+        int64_t To = std::llround(p.To.count() * 1000);
+        int64_t Tb = std::llround(p.Tb.count() * 1000);
+        int64_t Tr = std::llround(p.Tr.count() * 1000);
+
+        tiny.addDataPoint(To / 1000.0L, Tb / 1000.0L, Tr / 1000.0L);
+        mini.addDataPoint(To, Tb, Tr);
+        for (const auto& algo: {api_tiny, api_mini})
+            algo->addDataPoint(MiniSync::us_t{To / 1000.0L},
+                               MiniSync::us_t{Tb / 1000.0L},
+                               MiniSync::us_t{Tr / 1000.0L});
+        if (i == 0) continue;
+
+        REQUIRE(tiny.getDrift() == api_tiny->getDrift());
+        REQUIRE(tiny.getDriftError() == api_tiny->getDriftError());
+        REQUIRE(tiny.getOffset() == api_tiny->getOffset().count());
+        REQUIRE(tiny.getOffsetError() == api_tiny->getOffsetError().count());
+
+        REQUIRE(mini.getDrift() == api_mini->getDrift());
+        REQUIRE(mini.getDriftError() == api_mini->getDriftError());
+        REQUIRE(mini.getOffset() / 1000.0L == api_mini->getOffset().count());
+        REQUIRE(mini.getOffsetError() / 1000.0L == api_mini->getOffsetError().count());
+    }
+}
+
+TEST_CASE("Estimates can be read concurrently with updates", "[TinySync][MiniSync]")
+{
+    std::shared_ptr<MiniSync::API::Algorithm> reference;
+    std::shared_ptr<MiniSync::API::Algorithm> shared;
+    SECTION("TinySync")
+    {
+        reference = MiniSync::API::Factory::createTinySync();
+        shared = MiniSync::API::Factory::createTinySync();
+    }
+    SECTION("MiniSync")
+    {
+        reference = MiniSync::API::Factory::createMiniSync();
+        shared = MiniSync::API::Factory::createMiniSync();
+    }
+
+    const size_t n_samples = 20000;
+    const size_t n_readers = 4;
+
+    std::vector<MiniSync::API::DataPoint> samples(n_samples);
+    MiniSync::Workload::Generator{11}.fill(samples.data(), samples.size());
+
+    // every set of estimates the readers may observe, computed beforehand on a single thread
+    using Observed = std::tuple<long double, long double, long double, long double>;
+    auto observe = [](const MiniSync::API::Estimates& e)
+    { return Observed{e.drift, e.drift_error, e.offset.count(), e.offset_error.count()}; };
+
+    std::vector<Observed> expected{observe(reference->getEstimates())};
+    for (const auto& s: samples)
+    {
+        reference->addDataPoint(s.To, s.Tb, s.Tr);
+        expected.push_back(observe(reference->getEstimates()));
+    }
+    std::sort(expected.begin(), expected.end());
+
+    std::atomic<bool> done{false};
+    std::vector<std::vector<Observed>> seen(n_readers);
+    std::vector<std::thread> readers;
+    for (size_t r = 0; r < n_readers; ++r)
+    {
+        readers.emplace_back([&, r]()
+                             {
+                                 while (!done.load())
+                                 {
+                                     seen[r].push_back(observe(shared->getEstimates()));
+                                     shared->getCurrentAdjustedTime();
+                                 }
+                             });
+    }
+
+    for (const auto& s: samples)
+        shared->addDataPoint(s.To, s.Tb, s.Tr);
+    done.store(true);
+    for (auto& reader: readers)
+        reader.join();
+
+    // a torn read would mix estimates from different updates
+    size_t torn = 0;
+    for (const auto& reads: seen)
+        for (const auto& e: reads)
+            if (!std::binary_search(expected.begin(), expected.end(), e)) ++torn;
+    REQUIRE(torn == 0);
+    REQUIRE(observe(shared->getEstimates()) == observe(reference->getEstimates()));
+}
+
+TEST_CASE("AdjustedClock converts local time to the reference time base", "[AdjustedClock]")
+{
+    using steady = std::chrono::steady_clock;
+    const auto start = steady::now();
+    MiniSync::AdjustedClock<steady> clock{start};
+
+    // no estimates yet: identity
+    REQUIRE(clock.convert(start + std::chrono::seconds{5}) == std::chrono::seconds{5});
+
+    for (long double drift: {1.0L + 37e-6L, 1.0L - 120e-6L, 1.0L})
+    {
+        MiniSync::API::Estimates estimates;
+        estimates.drift = drift;
+        estimates.offset = MiniSync::us_t{-12345.678};
+        clock.update(estimates);
+
+        // up to ~a week after the start
+        for (int64_t ns = 0; ns < 600000000000000; ns = ns * 7 + 1234567)
+        {
+            const long double expected = (ns - estimates.offset.count() * 1000) / drift;
+            const auto actual = clock.convert(start + std::chrono::nanoseconds{ns});
+            REQUIRE(std::abs(actual.count() - expected) <= 1.0);
+        }
+    }
+
+    MiniSync::API::Estimates invalid;
+    invalid.drift = 0;
+    REQUIRE_THROWS(clock.update(invalid));
+}
+
+TEST_CASE("Adjusted time converts the system clock like AdjustedClock", "[AdjustedClock][TinySync][MiniSync]")
+{
+    using system = std::chrono::system_clock;
+    const long double drift = 1.0 + 50e-6;
+    const long double offset = -2500000.0; // µs
+
+    // local timestamps since the epoch of system_clock, as getCurrentAdjustedTime() expects
+    const long double now = std::chrono::duration_cast<MiniSync::us_t>(system::now().time_since_epoch()).count();
+    auto tiny = MiniSync::API::Factory::createTinySync();
+    auto fixed = std::make_shared<MiniSync::FixedMiniSync<16>>();
+    for (const auto& algo: {tiny, std::static_pointer_cast<MiniSync::API::Algorithm>(fixed)})
+    {
+        for (long double t: {now - 2e6L, now - 1e6L})
+        {
+            algo->addDataPoint(MiniSync::us_t{drift * (t - 100) + offset}, MiniSync::us_t{t},
+                               MiniSync::us_t{drift * (t + 100) + offset});
+        }
+
+        MiniSync::AdjustedClock<system> clock{};
+        clock.update(algo->getEstimates());
+        const auto before = clock.now();
+        const auto adjusted = algo->getCurrentAdjustedTime().time_since_epoch();
+        const auto after = clock.now();
+
+        REQUIRE(adjusted.count() >= before.count() / 1000.0L - 1);
+        REQUIRE(adjusted.count() <= after.count() / 1000.0L + 1);
+
+        // the reference time of the local clock reading, not the other way around
+        const long double elapsed = adjusted.count() - (now - offset) / drift;
+        REQUIRE(elapsed >= 0);
+        REQUIRE(elapsed < 1e6);
+    }
+}
+
+TEST_CASE("Bulk translation of local timestamps to the reference", "[TinySync][MiniSync]")
+{
+    std::shared_ptr<MiniSync::API::Algorithm> algo;
+    SECTION("TinySync")
+    {
+        algo = MiniSync::API::Factory::createTinySync();
+    }
+    SECTION("MiniSync")
+    {
+        algo = MiniSync::API::Factory::createMiniSync();
+    }
+    SECTION("MiniSync, integer nanoseconds")
+    {
+        MiniSync::API::Factory::MiniSyncOptions options;
+        options.time = MiniSync::API::Factory::TimeRepresentation::INT64_NANOSECONDS;
+        algo = MiniSync::API::Factory::createMiniSync(options);
+    }
+
+    int64_t t_local = 0;
+    int64_t out = 0;
+    REQUIRE_THROWS(algo->toReferenceTime(&t_local, 1, &out, &out, &out));
+
+    MiniSync::Workload::Options options;
+    options.skew = -42e-6;
+    options.offset = 3500.0; // µs
+    const long double drift = 1 + options.skew;
+    const long double offset = options.offset;
+    MiniSync::Workload::Generator generator{5, options};
+    long double t = 0; // reference time of the last sample
+    for (int i = 0; i < 1000; ++i)
+    {
+        const MiniSync::API::DataPoint p = generator.next().point;
+        algo->addDataPoint(p.To, p.Tb, p.Tr);
+        t = p.Tb.count();
+    }
+
+    // events after the last sample, up to weeks later (beyond the range of the AVX2 kernel), in a count which is
+    // not a multiple of the vector width
+    std::vector<int64_t> local;
+    const long double last = (drift * t + offset) * 1000; // ns
+    for (long double after = 1; after < 3e15; after *= 1.37)
+        local.push_back(std::llround(last + after));
+    REQUIRE(local.size() % 4 != 0);
+
+    std::vector<int64_t> reference(local.size());
+    std::vector<int64_t> lower(local.size());
+    std::vector<int64_t> upper(local.size());
+    algo->toReferenceTime(local.data(), local.size(), reference.data(), lower.data(), upper.data());
+
+    const long double est_drift = algo->getDrift();
+    const long double est_offset = algo->getOffset().count() * 1000;
+    for (size_t i = 0; i < local.size(); ++i)
+    {
+        const long double expected = (local[i] - est_offset) / est_drift;
+        const long double actual = (local[i] - offset * 1000) / drift;
+        REQUIRE(std::abs(reference[i] - expected) <= 1.0);
+        REQUIRE(lower[i] <= reference[i]);
+        REQUIRE(reference[i] <= upper[i]);
+        REQUIRE(lower[i] <= std::ceil(actual));
+        REQUIRE(std::floor(actual) <= upper[i]);
+    }
+}
+
+TEST_CASE("Restored checkpoints give identical estimates", "[TinySync][MiniSync]")
+{
+    std::function<std::shared_ptr<MiniSync::API::Algorithm>()> create;
+    // a different algorithm, which cannot restore the checkpoints
+    std::shared_ptr<MiniSync::API::Algorithm> foreign;
+    SECTION("TinySync")
+    {
+        create = []()
+        { return MiniSync::API::Factory::createTinySync(); };
+        foreign = MiniSync::API::Factory::createMiniSync();
+    }
+    SECTION("MiniSync")
+    {
+        create = []()
+        { return MiniSync::API::Factory::createMiniSync(); };
+        foreign = MiniSync::API::Factory::createTinySync();
+    }
+    SECTION("Windowed MiniSync")
+    {
+        create = []()
+        {
+            MiniSync::API::Factory::MiniSyncOptions options;
+            options.window_samples = 64;
+            return MiniSync::API::Factory::createMiniSync(options);
+        };
+        foreign = MiniSync::API::Factory::createMiniSync();
+    }
+    SECTION("Lazy MiniSync, integer nanoseconds")
+    {
+        create = []()
+        {
+            MiniSync::API::Factory::MiniSyncOptions options;
+            options.lazy = true;
+            options.time = MiniSync::API::Factory::TimeRepresentation::INT64_NANOSECONDS;
+            return MiniSync::API::Factory::createMiniSync(options);
+        };
+        foreign = MiniSync::API::Factory::createMiniSync();
+    }
+
+    MiniSync::Workload::Generator generator{3};
+    auto next = [&generator]()
+    { return generator.next().point; };
+
+    auto original = create();
+    for (int i = 0; i < 1000; ++i)
+    {
+        auto p = next();
+        original->addDataPoint(p.To, p.Tb, p.Tr);
+    }
+
+    const std::vector<uint8_t> blob = original->checkpoint();
+    auto restored = create();
+    restored->restore(blob.data(), blob.size());
+
+    // both go on exactly the same way
+    for (int i = 0; i < 500; ++i)
+    {
+        REQUIRE(restored->getDrift() == original->getDrift());
+        REQUIRE(restored->getDriftError() == original->getDriftError());
+        REQUIRE(restored->getOffset() == original->getOffset());
+        REQUIRE(restored->getOffsetError() == original->getOffsetError());
+
+        auto p = next();
+        original->addDataPoint(p.To, p.Tb, p.Tr);
+        restored->addDataPoint(p.To, p.Tb, p.Tr);
+    }
+    REQUIRE(restored->checkpoint() == original->checkpoint());
+
+    // truncated, corrupt or foreign checkpoints are rejected
+    auto other = create();
+    REQUIRE_THROWS_AS(other->restore(blob.data(), blob.size() - 1), std::invalid_argument);
+    std::vector<uint8_t> corrupt = blob;
+    corrupt[4] ^= 0xFF; // version
+    REQUIRE_THROWS_AS(other->restore(corrupt.data(), corrupt.size()), std::invalid_argument);
+    REQUIRE_THROWS_AS(foreign->restore(blob.data(), blob.size()), std::invalid_argument);
+}
+
+TEST_CASE("Checkpoints only restore with the same window", "[MiniSync]")
+{
+    std::vector<MiniSync::API::Factory::MiniSyncOptions> windows(4);
+    windows[1].window_samples = 100;
+    windows[2].window_samples = 1000;
+    windows[3].window_span = MiniSync::us_t{10e6};
+
+    for (size_t i = 0; i < windows.size(); ++i)
+    {
+        auto original = MiniSync::API::Factory::createMiniSync(windows[i]);
+        for (int k = 0; k < 10; ++k)
+            original->addDataPoint(MiniSync::us_t{k * 1000.0 - 100}, MiniSync::us_t{k * 1000.0},
+                                   MiniSync::us_t{k * 1000.0 + 100});
+        const auto blob = original->checkpoint();
+
+        for (size_t j = 0; j < windows.size(); ++j)
+        {
+            auto other = MiniSync::API::Factory::createMiniSync(windows[j]);
+            if (i == j)
+                REQUIRE_NOTHROW(other->restore(blob.data(), blob.size()));
+            else
+                REQUIRE_THROWS_AS(other->restore(blob.data(), blob.size()), std::invalid_argument);
+        }
+    }
+}
+
+TEST_CASE("Synthetic workloads are reproducible and match their ground truth", "[Workload]")
+{
+    MiniSync::Workload::Options options;
+    options.skew = -80e-6;
+    options.forward.minimum = 20;
+    options.forward.mean_jitter = 50;
+    options.backward.minimum = 400;
+    options.backward.mean_jitter = 2000;
+    options.backward.tail_probability = 0.01;
+    options.loss_probability = 0.1;
+
+    const size_t n = 100000;
+    std::vector<MiniSync::API::DataPoint> a(n);
+    std::vector<MiniSync::API::DataPoint> b(n);
+    MiniSync::Workload::Generator{7, options}.fill(a.data(), n);
+    MiniSync::Workload::Generator{7, options}.fill(b.data(), n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        REQUIRE(a[i].To == b[i].To);
+        REQUIRE(a[i].Tb == b[i].Tb);
+        REQUIRE(a[i].Tr == b[i].Tr);
+    }
+
+    // and the same on every standard library, up to the rounding of the math functions
+    REQUIRE(a[0].To.count() == Approx(112167.9208726944).epsilon(1e-12));
+    REQUIRE(a[0].Tb.count() == Approx(100000).epsilon(1e-12));
+    REQUIRE(a[0].Tr.count() == Approx(112986.74674194088).epsilon(1e-12));
+    REQUIRE(a[1].To.count() == Approx(212306.16837983699).epsilon(1e-12));
+    REQUIRE(a[1].Tr.count() == Approx(216302.50036320266).epsilon(1e-12));
+
+    MiniSync::Workload::Generator other{8, options};
+    REQUIRE(other.next().point.To != a[0].To);
+
+    MiniSync::Workload::Generator generator{7, options};
+    auto tiny = MiniSync::API::Factory::createTinySync();
+    auto mini = MiniSync::API::Factory::createMiniSync();
+    MiniSync::Workload::Sample s{};
+    for (size_t i = 0; i < n; ++i)
+    {
+        s = generator.next();
+        REQUIRE(s.point.To < s.point.Tr);
+        tiny->addDataPoint(s.point.To, s.point.Tb, s.point.Tr);
+        mini->addDataPoint(s.point.To, s.point.Tb, s.point.Tr);
+    }
+
+    // roughly one in ten exchanges lost
+    REQUIRE(generator.lost() > n / 10);
+    REQUIRE(generator.lost() < n / 8);
+
+    // constant skew, so the true relation is the same for all samples and has to be within the bounds
+    for (const auto& algo: {tiny, mini})
+    {
+        REQUIRE(std::abs(algo->getDrift() - s.drift) <= algo->getDriftError() * (1 + 1e-9));
+        REQUIRE(std::abs((algo->getOffset() - s.offset).count()) <= algo->getOffsetError().count() * (1 + 1e-9));
+        REQUIRE(algo->getDriftError() < 1e-6);
+    }
+}
+
+TEST_CASE("Replayed traces give the same estimates as the exchanges they recorded", "[Trace]")
+{
+    const char* path = "minisync_test.trace";
+    const size_t n = 10000;
+    MiniSync::Workload::Options options;
+    options.skew = 25e-6;
+    options.loss_probability = 0.05;
+
+    // both the trace and the direct path get the timestamps at the precision of the trace
+    auto direct = MiniSync::API::Factory::createMiniSync();
+    {
+        MiniSync::Workload::Generator generator{11, options};
+        MiniSync::Trace::Writer writer{path};
+        for (size_t i = 0; i < n; ++i)
+        {
+            const MiniSync::API::DataPoint p = generator.next().point;
+            const int64_t to = MiniSync::Trace::toNanoseconds(p.To);
+            const int64_t tb = MiniSync::Trace::toNanoseconds(p.Tb);
+            const int64_t tr = MiniSync::Trace::toNanoseconds(p.Tr);
+            writer.write(MiniSync::Trace::TraceRecord{to, tb, tb + 10000, tr});
+
+            const MiniSync::us_t to_us{std::chrono::nanoseconds{to}};
+            const MiniSync::us_t tr_us{std::chrono::nanoseconds{tr}};
+            direct->addDataPoint(to_us, MiniSync::us_t{std::chrono::nanoseconds{tb}}, tr_us);
+            direct->addDataPoint(to_us, MiniSync::us_t{std::chrono::nanoseconds{tb + 10000}}, tr_us);
+        }
+    }
+
+    auto replayed = MiniSync::API::Factory::createMiniSync();
+    {
+        MiniSync::Trace::MappedTrace trace{path};
+        REQUIRE(trace.count() == n);
+        for (size_t i = 0; i < trace.count(); ++i)
+            MiniSync::Trace::addRecord(*replayed, trace.records()[i]);
+    }
+    std::remove(path);
+
+    REQUIRE(replayed->getDrift() == direct->getDrift());
+    REQUIRE(replayed->getDriftError() == direct->getDriftError());
+    REQUIRE(replayed->getOffset() == direct->getOffset());
+    REQUIRE(replayed->getOffsetError() == direct->getOffsetError());
+    REQUIRE(std::abs(replayed->getDrift() - (1 + options.skew)) <= replayed->getDriftError());
+
+    // a truncated trace is rejected
+    {
+        FILE* f = fopen(path, "wb");
+        REQUIRE(f != nullptr);
+        REQUIRE(fwrite(MiniSync::Trace::MAGIC, 1, sizeof(MiniSync::Trace::MAGIC), f) == 4);
+        fclose(f);
+    }
+    REQUIRE_THROWS_AS(MiniSync::Trace::MappedTrace{path}, std::runtime_error);
+    std::remove(path);
+}
+
+TEST_CASE("Metrics report the stored points and counters", "[TinySync][MiniSync]")
+{
+    MiniSync::Workload::Generator generator{3};
+    std::vector<MiniSync::API::DataPoint> samples(5000);
+    generator.fill(samples.data(), samples.size());
+
+    MiniSync::API::Factory::MiniSyncOptions windowed;
+    windowed.window_samples = 100;
+    MiniSync::API::Factory::MiniSyncOptions lazy;
+    lazy.lazy = true;
+
+    auto tiny = MiniSync::API::Factory::createTinySync();
+    auto mini = MiniSync::API::Factory::createMiniSync();
+    auto mini_windowed = MiniSync::API::Factory::createMiniSync(windowed);
+    auto mini_lazy = MiniSync::API::Factory::createMiniSync(lazy);
+
+    const auto empty = mini->getMetrics();
+    REQUIRE(empty.samples == 0);
+    REQUIRE(empty.low_points == 0);
+    REQUIRE(empty.constraints == 0);
+    REQUIRE(empty.pairs_evaluated == 0);
+
+    for (const auto& s: samples)
+    {
+        for (const auto& algo: {tiny, mini, mini_windowed, mini_lazy})
+            algo->addDataPoint(s.To, s.Tb, s.Tr);
+    }
+
+    for (const auto& algo: {tiny, mini, mini_windowed, mini_lazy})
+    {
+        const auto metrics = algo->getMetrics();
+        REQUIRE(metrics.samples == samples.size());
+        REQUIRE(metrics.low_points >= 2);
+        REQUIRE(metrics.high_points >= 2);
+        REQUIRE(metrics.memory_bytes > 0);
+
+        if (metrics.instrumented)
+        {
+            REQUIRE(metrics.update_ns > 0);
+            REQUIRE(metrics.update_ns >= metrics.cleanup_ns);
+        }
+        else
+        {
+            REQUIRE(metrics.pairs_evaluated == 0);
+            REQUIRE(metrics.update_ns == 0);
+        }
+    }
+
+    // TinySync only keeps the points of the current constraints
+    REQUIRE(tiny->getMetrics().low_points <= 2);
+    REQUIRE(tiny->getMetrics().high_points <= 2);
+    REQUIRE(tiny->getMetrics().constraints == 2);
+    REQUIRE(mini_windowed->getMetrics().low_points <= 100);
+    REQUIRE(mini_windowed->getMetrics().high_points <= 100);
+
+    // queued data points are counted, but not processed by getMetrics()
+    const auto queued = mini_lazy->getMetrics();
+    REQUIRE(queued.pending > 0);
+    mini_lazy->getDrift();
+    const auto processed = mini_lazy->getMetrics();
+    REQUIRE(processed.pending == 0);
+    REQUIRE(processed.samples == samples.size());
+    REQUIRE(processed.low_points == mini->getMetrics().low_points);
+    REQUIRE(processed.high_points == mini->getMetrics().high_points);
+    if (processed.instrumented)
+        REQUIRE(processed.pairs_evaluated == mini->getMetrics().pairs_evaluated);
+}
+
+TEST_CASE("Updates allocate no memory once warmed up", "[TinySync][MiniSync]")
+{
+    std::vector<MiniSync::API::DataPoint> samples(30000);
+    MiniSync::Workload::Generator{5}.fill(samples.data(), samples.size());
+    const size_t warm_up = 5000;
+
+    MiniSync::API::Factory::MiniSyncOptions options;
+    MiniSync::API::Factory::TinySyncOptions tiny_options;
+    SECTION("TinySync")
+    {}
+    SECTION("TinySync, integer ns")
+    {
+        tiny_options.time = MiniSync::API::Factory::TimeRepresentation::INT64_NANOSECONDS;
+    }
+    SECTION("MiniSync")
+    {}
+    SECTION("Windowed MiniSync")
+    {
+        options.window_samples = 1000;
+    }
+    SECTION("Lazy MiniSync")
+    {
+        options.lazy = true;
+    }
+    auto tiny = MiniSync::API::Factory::createTinySync(tiny_options);
+    auto mini = MiniSync::API::Factory::createMiniSync(options);
+
+    for (const auto& algo: {tiny, mini})
+    {
+        for (size_t i = 0; i < warm_up; ++i)
+            algo->addDataPoint(samples[i].To, samples[i].Tb, samples[i].Tr);
+
+        MiniSync::Bench::resetAllocStats();
+        long double sink = 0;
+        for (size_t i = warm_up; i < samples.size(); ++i)
+        {
+            algo->addDataPoint(samples[i].To, samples[i].Tb, samples[i].Tr);
+            if (i % 16 == 0) sink += algo->getDrift() + algo->getEstimates().offset.count();
+        }
+        const auto stats = MiniSync::Bench::allocStats();
+
+        REQUIRE(sink != 0);
+        REQUIRE(stats.allocations == 0);
+    }
+}
+
+TEMPLATE_TEST_CASE("Fixed-size TinySync matches BasicSync", "[TinySync]",
+                   MiniSync::Time::LongDoubleMicroseconds, MiniSync::Time::Int64Nanoseconds)
+{
+    using Fixed = MiniSync::FixedTinySync<TestType>;
+    static_assert(std::is_pod<Fixed>::value, "FixedTinySync must be a POD.");
+
+    MiniSync::Workload::Options options;
+    options.backward.tail_probability = 0.05;
+    MiniSync::Workload::Generator generator{11, options};
+
+    Fixed fixed{};
+    MiniSync::BasicSync<MiniSync::Retention::TinySync, TestType> basic;
+    REQUIRE(fixed.getDrift() == basic.getDrift());
+    REQUIRE(fixed.getOffset() == basic.getOffset());
+
+    for (int i = 0; i < 20000; ++i)
+    {
+        const auto s = generator.next().point;
+        const auto To = TestType::fromMicroseconds(s.To);
+        const auto Tb = TestType::fromMicroseconds(s.Tb);
+        const auto Tr = TestType::fromMicroseconds(s.Tr);
+
+        REQUIRE(fixed.addDataPoint(To, Tb, Tr) == (i > 0));
+        basic.addDataPoint(To, Tb, Tr);
+
+        REQUIRE(fixed.getDrift() == basic.getDrift());
+        REQUIRE(fixed.getDriftError() == basic.getDriftError());
+        REQUIRE(fixed.getOffset() == basic.getOffset());
+        REQUIRE(fixed.getOffsetError() == basic.getOffsetError());
+    }
+
+    // copies carry on independently
+    Fixed copy = fixed;
+    const auto s = generator.next().point;
+    copy.addDataPoint(TestType::fromMicroseconds(s.To), TestType::fromMicroseconds(s.Tb),
+                      TestType::fromMicroseconds(s.Tr));
+    REQUIRE(copy.processedSamples() == fixed.processedSamples() + 1);
+
+    fixed.reset();
+    REQUIRE(fixed.processedSamples() == 0);
+    REQUIRE_FALSE(fixed.hasConstraints());
+    REQUIRE(fixed.getDrift() == 1);
+}
+
+TEST_CASE("Fixed-capacity MiniSync", "[MiniSync]")
+{
+    MiniSync::Workload::Options options;
+    options.backward.tail_probability = 0.05;
+    std::vector<MiniSync::API::DataPoint> samples(20000);
+    MiniSync::Workload::Generator{13, options}.fill(samples.data(), samples.size());
+
+    SECTION("Matches MiniSync while the hulls fit")
+    {
+        auto mini = MiniSync::API::Factory::createMiniSync();
+        auto fixed = std::make_shared<MiniSync::FixedMiniSync<256>>();
+        for (const auto& s: samples)
+        {
+            mini->addDataPoint(s.To, s.Tb, s.Tr);
+            fixed->addDataPoint(s.To, s.Tb, s.Tr);
+            REQUIRE(fixed->getDrift() == mini->getDrift());
+            REQUIRE(fixed->getDriftError() == mini->getDriftError());
+            REQUIRE(fixed->getOffset() == mini->getOffset());
+            REQUIRE(fixed->getOffsetError() == mini->getOffsetError());
+        }
+        REQUIRE(fixed->getMetrics().low_points == mini->getMetrics().low_points);
+        REQUIRE(fixed->getMetrics().high_points == mini->getMetrics().high_points);
+    }
+
+    SECTION("Stays at least as tight as TinySync when full")
+    {
+        const long double drift = 1 + options.skew;
+        auto tiny = MiniSync::API::Factory::createTinySync();
+        auto fixed2 = std::make_shared<MiniSync::FixedMiniSync<2>>();
+        auto fixed4 = std::make_shared<MiniSync::FixedMiniSync<4>>();
+        for (const auto& s: samples)
+        {
+            tiny->addDataPoint(s.To, s.Tb, s.Tr);
+            for (const auto& fixed: std::initializer_list<std::shared_ptr<MiniSync::API::Algorithm>>{fixed2, fixed4})
+            {
+                fixed->addDataPoint(s.To, s.Tb, s.Tr);
+                REQUIRE(fixed->getDriftError() <= tiny->getDriftError());
+                REQUIRE(fixed->getOffsetError() <= tiny->getOffsetError());
+                // no estimates before the second sample
+                if (fixed->getDriftError() > 0)
+                    REQUIRE(std::abs(fixed->getDrift() - drift) <= fixed->getDriftError() * (1 + 1e-9));
+            }
+        }
+        REQUIRE(fixed2->getMetrics().low_points <= 2);
+        REQUIRE(fixed4->getMetrics().low_points <= 4);
+        REQUIRE(fixed4->getMetrics().high_points <= 4);
+        REQUIRE(fixed4->getDriftError() <= fixed2->getDriftError());
+    }
+
+    SECTION("Runs from static storage without allocating")
+    {
+        static MiniSync::FixedMiniSync<16, MiniSync::Time::Int64Nanoseconds> fixed;
+        MiniSync::Bench::resetAllocStats();
+        for (const auto& s: samples)
+            fixed.addDataPoint(s.To, s.Tb, s.Tr);
+        const auto estimates = fixed.getEstimates();
+        REQUIRE(MiniSync::Bench::allocStats().allocations == 0);
+        REQUIRE(estimates.drift == fixed.getDrift());
+
+        // checkpoints go through the heap, but restore exactly
+        const auto blob = fixed.checkpoint();
+        MiniSync::FixedMiniSync<16, MiniSync::Time::Int64Nanoseconds> restored;
+        restored.restore(blob.data(), blob.size());
+        REQUIRE(restored.getDrift() == fixed.getDrift());
+        REQUIRE(restored.getOffsetError() == fixed.getOffsetError());
+        REQUIRE(restored.checkpoint() == blob);
+
+        MiniSync::FixedMiniSync<8, MiniSync::Time::Int64Nanoseconds> smaller;
+        REQUIRE_THROWS_AS(smaller.restore(blob.data(), blob.size()), std::invalid_argument);
+        auto mini = MiniSync::API::Factory::createMiniSync();
+        REQUIRE_THROWS_AS(mini->restore(blob.data(), blob.size()), std::invalid_argument);
+    }
+
+    SECTION("Rejects checkpoints with invalid hulls")
+    {
+        using Fixed = MiniSync::FixedMiniSync<16, MiniSync::Time::Int64Nanoseconds>;
+        Fixed fixed;
+        for (const auto& s: samples)
+            fixed.addDataPoint(s.To, s.Tb, s.Tr);
+        const auto blob = fixed.checkpoint();
+        const size_t low_n = fixed.getMetrics().low_points;
+        const size_t high_n = fixed.getMetrics().high_points;
+        REQUIRE(low_n >= 3);
+
+        // the checkpoint ends with the low hull and then the high hull: count, xs, ys, ids
+        const size_t point_size = 2 * sizeof(int64_t) + sizeof(MiniSync::PointId);
+        const size_t low_start = blob.size() - (4 + high_n * point_size) - (4 + low_n * point_size);
+        const size_t low_ys = low_start + 4 + low_n * sizeof(int64_t);
+        const size_t low_ids = low_ys + low_n * sizeof(int64_t);
+
+        // a vertex below the chord of its neighbours in the upper hull of the low points
+        std::vector<uint8_t> concave = blob;
+        std::memcpy(concave.data() + low_ys + sizeof(int64_t), concave.data() + low_ys, sizeof(int64_t));
+        Fixed restored;
+        REQUIRE_THROWS_AS(restored.restore(concave.data(), concave.size()), std::invalid_argument);
+
+        // a valid hull, but without the points of the constraints
+        std::vector<uint8_t> renamed = blob;
+        for (size_t i = 0; i < low_n; ++i)
+        {
+            MiniSync::PointId id;
+            std::memcpy(&id, renamed.data() + low_ids + i * sizeof(id), sizeof(id));
+            id += 1000000;
+            std::memcpy(renamed.data() + low_ids + i * sizeof(id), &id, sizeof(id));
+        }
+        REQUIRE_THROWS_AS(restored.restore(renamed.data(), renamed.size()), std::invalid_argument);
+
+        // and neither changed it
+        REQUIRE(restored.checkpoint() == Fixed{}.checkpoint());
+        restored.restore(blob.data(), blob.size());
+        REQUIRE(restored.checkpoint() == blob);
+    }
+}